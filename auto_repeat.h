@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+
+#include "input.h"
+
+// Delayed auto shift (DAS) and auto repeat rate (ARR) for the held movement
+// keys. A fresh press acts once immediately; a key still held after DAS acts
+// again every ARR, on the game's own clock rather than the OS key repeat.
+//
+// With the kitty keyboard protocol the terminal reports real releases, so
+// DAS is exact. Legacy terminals only send the OS auto-repeat as more
+// presses, so every separate press still acts once, a hold is only
+// confirmed once the OS repeat stream starts (a tap must never slide the
+// piece) and a release is inferred when that stream stops.
+
+enum RepeatKey : uint8_t {
+    REPEAT_LEFT,
+    REPEAT_RIGHT,
+    REPEAT_DOWN,
+    REPEAT_KEYS,
+};
+
+struct RepeatTiming {
+    int64_t dasNs;
+    int64_t arrNs;      // 0 = move as far as possible at once
+};
+
+struct AutoRepeat {
+    // Upper bound of actions per due() call, enough to cross any board
+    static constexpr int INSTANT_REPEATS = 64;
+    // With ARR 0 a held key re-checks once per frame (e.g. for a new piece)
+    static constexpr int64_t INSTANT_RECHECK_NS = 16666667;
+
+    RepeatTiming timing[REPEAT_KEYS] = {
+        {167000000, 33000000},    // left: 10 frames DAS, 2 frames ARR
+        {167000000, 33000000},    // right
+        {0, 33000000},            // down: soft drop at 30 rows per second
+    };
+
+    // Legacy terminals: presses further apart than this are separate taps;
+    // closer ones are the OS auto-repeat, which confirms a hold. Once
+    // repeats stop for twice their observed interval the key counts as
+    // released (never less than minReleaseNs).
+    int64_t firstRepeatNs{700000000};
+    int64_t streamGapNs{100000000};
+    int64_t minReleaseNs{40000000};
+
+    bool releaseEvents{false};  // terminal reports releases (kitty protocol)
+
+    struct KeyState {
+        bool down{false};
+        bool confirmed{false};  // known to be held, repeating may start
+        int64_t pressNs{0};
+        int64_t lastEventNs{0};
+        int64_t intervalNs{0};  // latest OS repeat interval (legacy)
+        int64_t nextFireNs{0};
+    };
+
+    KeyState keys[REPEAT_KEYS]{};
+    int horizontal{-1};         // most recently pressed of left/right
+
+    // Feed a key event; returns how many actions to perform right now
+    int onEvent(RepeatKey key, KeyAction action, int64_t timeNs) {
+        KeyState& state = keys[key];
+        if (action == KeyAction::Release) {
+            state.down = false;
+            return 0;
+        }
+
+        if (releaseEvents) {
+            // Terminal repeats are ignored, our own schedule drives them.
+            // A repeat of a key we think is up (its release was flushed)
+            // starts a new hold.
+            if (state.down) return 0;
+            press(key, timeNs);
+            state.confirmed = true;
+            return 1;
+        }
+
+        int64_t gap = timeNs - state.lastEventNs;
+        if (!held(key, timeNs) || gap > firstRepeatNs) {
+            press(key, timeNs);
+            return 1;
+        }
+
+        state.lastEventNs = timeNs;
+        if (gap > streamGapNs) {
+            // A second tap, or the OS repeat delay: one more step
+            return 1;
+        }
+
+        // Inside the OS repeat stream: the key is held
+        state.intervalNs = gap;
+        if (!state.confirmed) {
+            state.confirmed = true;
+            if (state.nextFireNs < timeNs) state.nextFireNs = timeNs;
+        }
+        return 0;
+    }
+
+    void press(RepeatKey key, int64_t timeNs) {
+        KeyState& state = keys[key];
+        state.down = true;
+        state.confirmed = false;
+        state.pressNs = state.lastEventNs = timeNs;
+        state.intervalNs = 0;
+        // The press itself is the first action, so with no DAS the first
+        // repeat is still one ARR later; a tap must act exactly once
+        const RepeatTiming& t = timing[key];
+        state.nextFireNs = timeNs + (t.dasNs > 0 ? t.dasNs : t.arrNs > 0 ? t.arrNs : INSTANT_RECHECK_NS);
+        if (key != REPEAT_DOWN) horizontal = key;
+    }
+
+    bool held(RepeatKey key, int64_t nowNs) {
+        KeyState& state = keys[key];
+        if (state.down && !releaseEvents) {
+            int64_t limit = firstRepeatNs;
+            if (state.confirmed) {
+                limit = 2 * state.intervalNs;
+                if (limit < minReleaseNs) limit = minReleaseNs;
+            }
+            if (nowNs - state.lastEventNs > limit) state.down = false;
+        }
+        return state.down;
+    }
+
+    // Repeat actions that fell due by nowNs
+    int due(RepeatKey key, int64_t nowNs) {
+        if (!held(key, nowNs)) return 0;
+
+        KeyState& state = keys[key];
+        if (!state.confirmed || nowNs < state.nextFireNs) return 0;
+
+        int64_t arr = timing[key].arrNs;
+        // Holding both directions moves toward the one pressed last; the
+        // other one keeps its timer moving so deadline() stays ahead
+        if (key != REPEAT_DOWN && horizontal >= 0 && horizontal != key &&
+            held(static_cast<RepeatKey>(horizontal), nowNs)) {
+            state.nextFireNs = nowNs + (arr > 0 ? arr : INSTANT_RECHECK_NS);
+            return 0;
+        }
+
+        if (arr <= 0) {
+            state.nextFireNs = nowNs + INSTANT_RECHECK_NS;
+            return INSTANT_REPEATS;
+        }
+        int64_t count = (nowNs - state.nextFireNs) / arr + 1;
+        state.nextFireNs += count * arr;
+        return count < INSTANT_REPEATS ? static_cast<int>(count) : INSTANT_REPEATS;
+    }
+
+    // Earliest time due() may return actions, or -1
+    int64_t deadline() const {
+        int64_t earliest = -1;
+        for (const KeyState& state : keys) {
+            if (!state.down || !state.confirmed) continue;
+            if (earliest < 0 || state.nextFireNs < earliest) earliest = state.nextFireNs;
+        }
+        return earliest;
+    }
+
+    void releaseAll() {
+        for (KeyState& state : keys) state.down = false;
+    }
+};
@@ -0,0 +1,63 @@
+// Checks of the DAS/ARR schedule against a fake clock: make check
+#include <cstdio>
+
+#include "auto_repeat.h"
+
+using namespace std;
+
+static constexpr int64_t MS = 1000000;
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        ++failures;
+    }
+}
+
+// Actions from one press of `key` released at releaseNs, with the run
+// loop polling due() every millisecond until untilNs
+static int tap(AutoRepeat& repeat, RepeatKey key, int64_t releaseNs, int64_t untilNs) {
+    int actions = repeat.onEvent(key, KeyAction::Press, 0);
+    for (int64_t now = 0; now <= untilNs; now += MS) {
+        if (now == releaseNs) repeat.onEvent(key, KeyAction::Release, now);
+        actions += repeat.due(key, now);
+    }
+    return actions;
+}
+
+int main() {
+    {
+        AutoRepeat repeat;
+        repeat.releaseEvents = true;
+        expect(tap(repeat, REPEAT_DOWN, 20 * MS, 500 * MS) == 1, "kitty: soft drop tap moves one row");
+    }
+    {
+        AutoRepeat repeat;
+        repeat.releaseEvents = true;
+        expect(tap(repeat, REPEAT_LEFT, 100 * MS, 500 * MS) == 1, "kitty: left tap inside DAS moves once");
+    }
+    {
+        AutoRepeat repeat;
+        repeat.releaseEvents = true;
+        // Press, then 10 repeats at 33 ms
+        expect(tap(repeat, REPEAT_DOWN, 340 * MS, 500 * MS) == 11, "kitty: held soft drop repeats every ARR");
+    }
+    {
+        AutoRepeat repeat;
+        repeat.releaseEvents = true;
+        repeat.onEvent(REPEAT_RIGHT, KeyAction::Press, 0);
+        repeat.onEvent(REPEAT_LEFT, KeyAction::Press, 1 * MS);
+        int wakes = 0;
+        for (int64_t now = 0; now < 1000 * MS && wakes < 1000; ++wakes) {
+            repeat.due(REPEAT_LEFT, now);
+            repeat.due(REPEAT_RIGHT, now);
+            int64_t next = repeat.deadline();
+            now = next > now ? next : now + 1;
+        }
+        expect(wakes < 100, "kitty: holding both directions does not spin");
+    }
+
+    if (failures == 0) printf("auto_repeat: all checks passed\n");
+    return failures == 0 ? 0 : 1;
+}
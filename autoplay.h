@@ -0,0 +1,419 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "engine.h"
+#include "movegen.h"
+#include "transposition.h"
+
+// Built-in AI player. Every placement of the current piece (from
+// MoveGenerator) is scored with a linear board heuristic, and a beam
+// search carries the best boards forward through the preview queue; the
+// move played is the first placement of the best line found.
+//
+// Each beam layer is expanded in parallel: threads take beam nodes one at
+// a time and write the children into their own buffers, which are merged
+// and ranked with a total order afterwards. The choice therefore never
+// depends on the thread count or on scheduling, and replays stay exact.
+//
+// Boards carry incremental Zobrist hashes. Expanded nodes go into a shared
+// lock-free TranspositionTable: about half of each search repeats nodes
+// the previous move's search already expanded. A board reached through
+// different placements in the same layer is kept in the beam once.
+
+// Heuristic weights: holes, aggregate height, bumpiness, lines
+struct EvalWeights {
+    double height{-0.51};       // sum of column heights
+    double lines{0.76};         // lines cleared
+    double holes{-0.36};        // empty cells with a block above them
+    double bumpiness{-0.18};    // sum of height steps between columns
+};
+
+// Higher is better. Lines cleared are scored separately, along the path
+// that led to a board (see AutoPlayer::makeChild).
+template <int Width, int Height, typename RowMask>
+double evaluateBoard(const RowMask (&rows)[Height], const EvalWeights& weights) {
+    int heights[Width]{};
+    int holes = 0;
+    RowMask covered = 0;        // columns with a block somewhere above
+    for (int y = 0; y < Height; ++y) {
+        holes += __builtin_popcount(covered & static_cast<RowMask>(~rows[y]));
+        for (RowMask top = rows[y] & static_cast<RowMask>(~covered); top;
+             top &= static_cast<RowMask>(top - 1)) {
+            heights[__builtin_ctz(top)] = Height - y;
+        }
+        covered |= rows[y];
+    }
+
+    int aggregate = 0;
+    int bumpiness = 0;
+    for (int x = 0; x < Width; ++x) {
+        aggregate += heights[x];
+        if (x > 0) bumpiness += std::abs(heights[x] - heights[x - 1]);
+    }
+
+    return weights.height * aggregate + weights.holes * holes +
+           weights.bumpiness * bumpiness;
+}
+
+// Occupancy only: all that search needs of a Board, and cheap to copy.
+// The Zobrist hash is kept the same way as Board::hash.
+template <int Width, int Height>
+struct SearchBoard {
+    using Board = BasicBoard<Width, Height>;
+    using RowMask = typename Board::RowMask;
+    using Keys = typename Board::Keys;
+
+    RowMask rows[Height]{};
+    uint64_t hash{0};
+
+    void place(const Piece& piece) {
+        const PieceMask* masks = BlockTemplate::rowMasks(piece.type, piece.rotation);
+#pragma GCC unroll 4
+        for (int i = 0; i < BLOCK_SIZE; ++i) {
+            int y = piece.pos.y + i;
+            if (masks[i] == 0 || y < 0 || y >= Height) continue;
+            uint32_t m = piece.pos.x < 0 ? masks[i] >> -piece.pos.x
+                                         : static_cast<uint32_t>(masks[i]) << piece.pos.x;
+            RowMask added = static_cast<RowMask>(m & ~rows[y]);
+            hash ^= Keys::row(y, added);
+            rows[y] |= added;
+        }
+    }
+
+    int clearLines() {
+        int writeRow = Height - 1;
+        for (int readRow = Height - 1; readRow >= 0; --readRow) {
+            RowMask row = rows[readRow];
+            if (row == Board::FULL_ROW) {
+                hash ^= Keys::row(readRow, row);
+            } else {
+                if (writeRow != readRow) {
+                    hash ^= Keys::row(readRow, row) ^ Keys::row(writeRow, row);
+                }
+                rows[writeRow--] = row;
+            }
+        }
+        int lines = writeRow + 1;
+        while (writeRow >= 0) rows[writeRow--] = 0;
+        return lines;
+    }
+};
+
+template <int Width, int Height>
+struct SearchNode {
+    SearchBoard<Width, Height> board;
+    double value{0};
+    int lines{0};               // cleared on the way here from the root
+    uint16_t root{0};           // root placement this line starts with
+    uint32_t order{0};          // parent index and placement index, breaks ties
+};
+
+template <int Width, int Height>
+struct BasicAutoPlayer {
+    using Engine = BasicEngine<Width, Height>;
+    using MoveGenerator = BasicMoveGenerator<Width, Height>;
+    using SearchBoard = ::SearchBoard<Width, Height>;
+    using SearchNode = ::SearchNode<Width, Height>;
+
+    static constexpr int DEFAULT_BEAM = 32;
+    static constexpr int MAX_PATH = 256;
+    static constexpr int CACHE_BITS = 11;   // 2048 nodes, about 1.3 MB up to 15 wide
+    // An empty 32 wide board has over 120 placements of a T
+    static constexpr int CACHE_CHILDREN = 4 * Width + 20 > 80 ? 4 * Width + 20 : 80;
+    using TranspositionTable = BasicTranspositionTable<CACHE_CHILDREN>;
+
+    int beamWidth{DEFAULT_BEAM};
+    int lookahead{PieceQueue::MAX_DEPTH};   // preview pieces searched, capped by the queue
+    EvalWeights weights;   // changing them needs cache.clear()
+
+    TranspositionTable cache{CACHE_BITS};
+    int upcoming[PieceQueue::MAX_DEPTH + 2]{};  // pieces to place after the current one, -1 past the search
+
+    // The placement being played, as its cell key (see nextAction)
+    bool planned{false};
+    uint32_t plannedRevision{0};
+    uint32_t targetKey{0};
+
+    MoveGenerator gen;          // current piece: root placements and paths
+    std::vector<SearchNode> beam;
+    std::vector<SearchNode> ranked;
+
+    struct Worker {
+        MoveGenerator gen;
+        CachedChild cached[MoveGenerator::MAX_PLACEMENTS];
+        std::vector<SearchNode> children;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;   // [0] is the calling thread
+
+    // Layer expansion, shared with the threads
+    int layer{0};
+    int layerType{0};
+    std::atomic<int> nextNode{0};
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    uint64_t generation{0};
+    int busy{0};
+    bool stopping{false};
+    std::vector<std::thread> threads;
+
+    // threadCount <= 0 uses one thread per hardware thread
+    explicit BasicAutoPlayer(int threadCount) {
+        if (threadCount <= 0) {
+            threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+        for (int i = 0; i < threadCount; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (int i = 1; i < threadCount; ++i) {
+            threads.emplace_back(&BasicAutoPlayer::threadMain, this, i);
+        }
+    }
+
+    ~BasicAutoPlayer() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads) t.join();
+    }
+
+    BasicAutoPlayer(const BasicAutoPlayer&) = delete;
+    BasicAutoPlayer& operator=(const BasicAutoPlayer&) = delete;
+
+    // ---------- search ----------
+
+    // Choose a placement for the engine's current piece. Returns false
+    // when every placement tops out (the game is lost whatever we do).
+    bool plan(const Engine& engine) {
+        const Piece& piece = engine.currentPiece;
+        SearchBoard start;
+        std::copy(engine.board.rows, engine.board.rows + Height, start.rows);
+        start.hash = engine.board.hash;
+
+        int depth = std::min(lookahead, engine.queue.depth);
+        for (int k = 0; k < PieceQueue::MAX_DEPTH + 2; ++k) {
+            upcoming[k] = k < depth ? engine.queue.peek(k) : -1;
+        }
+
+        beam.clear();
+        int count = gen.generate(engine.board, piece);
+        for (int i = 0; i < count; ++i) {
+            SearchNode node;
+            if (!makeChild(start, 0, piece.type, gen.placements[i], node)) continue;
+            node.root = static_cast<uint16_t>(i);
+            node.order = static_cast<uint32_t>(i);
+            beam.push_back(node);
+        }
+        if (beam.empty()) return false;
+        keepBest(beam);
+
+        for (int k = 0; k < depth; ++k) {
+            expandLayer(k);
+            // Every line tops out on this piece: go with the best so far
+            if (ranked.empty()) break;
+            keepBest(ranked);
+            beam.swap(ranked);
+        }
+
+        const Placement& best = gen.placements[beam[0].root];
+        targetKey = MoveGenerator::cellKey(piece.type, best.rotation, best.x, best.y);
+        return true;
+    }
+
+    // Plan, then write the whole input path (ending with HardDrop) for
+    // play without gravity in between. Returns its length, 0 when lost.
+    int planPath(const Engine& engine, Action* out, int max) {
+        planned = false;
+        if (!plan(engine)) return 0;
+        const Placement* target = findTarget(engine.currentPiece.type);
+        return target ? gen.path(*target, out, max) : 0;
+    }
+
+    // One input toward the planned placement, for play at human speed
+    // where gravity moves the piece between inputs. The path is found
+    // again from wherever the piece is now; a new piece, or a target that
+    // is no longer reachable, is planned from scratch.
+    Action nextAction(const Engine& engine) {
+        if (!engine.state.running) return Action::None;
+
+        if (!planned || plannedRevision != engine.board.revision) {
+            planned = plan(engine);
+            plannedRevision = engine.board.revision;
+            if (!planned) return Action::HardDrop;
+        }
+
+        Action first;
+        if (firstStep(engine, first)) return first;
+        planned = plan(engine);
+        if (planned && firstStep(engine, first)) return first;
+        return Action::HardDrop;
+    }
+
+    bool firstStep(const Engine& engine, Action& out) {
+        gen.generate(engine.board, engine.currentPiece);
+        const Placement* target = findTarget(engine.currentPiece.type);
+        if (!target) return false;
+
+        Action path[MAX_PATH];
+        if (gen.path(*target, path, MAX_PATH) == 0) return false;
+        out = path[0];
+        return true;
+    }
+
+    // The planned placement among gen's current placements
+    const Placement* findTarget(int type) const {
+        for (int i = 0; i < gen.count; ++i) {
+            const Placement& p = gen.placements[i];
+            if (MoveGenerator::cellKey(type, p.rotation, p.x, p.y) == targetKey) return &p;
+        }
+        return nullptr;
+    }
+
+    // Board after `placement`, scored. False if the piece would lock above
+    // the visible board, which tops out.
+    bool makeChild(const SearchBoard& board, int lines, int type, const Placement& placement,
+                   SearchNode& child) const {
+        if (placement.y < 0) return false;
+        child.board = board;
+        child.board.place(MoveGenerator::toPiece(type, placement));
+        child.lines = lines + child.board.clearLines();
+        child.value = score(child, static_cast<float>(evaluateBoard<Width>(child.board.rows, weights)));
+        return true;
+    }
+
+    // Heuristic scores are kept as float, cached or not, so a cache hit
+    // never changes the ranking
+    double score(const SearchNode& node, float boardScore) const {
+        return boardScore + weights.lines * node.lines;
+    }
+
+    // Best beamWidth distinct boards first, ties in a fixed order. Equal
+    // boards in one layer score equally, so of a transposition the first
+    // in that order is kept. Sorted a slice at a time: only the top of
+    // the layer is ever needed.
+    void keepBest(std::vector<SearchNode>& nodes) const {
+        auto better = [](const SearchNode& a, const SearchNode& b) {
+            if (a.value != b.value) return a.value > b.value;
+            return a.order < b.order;
+        };
+
+        size_t width = static_cast<size_t>(std::max(1, beamWidth));
+        size_t kept = 0;
+        size_t sorted = 0;
+        while (kept < width && sorted < nodes.size()) {
+            size_t end = std::min(nodes.size(), sorted + 2 * (width - kept));
+            std::partial_sort(nodes.begin() + sorted, nodes.begin() + end, nodes.end(), better);
+            for (; sorted < end && kept < width; ++sorted) {
+                const SearchNode& node = nodes[sorted];
+                bool seen = false;
+                for (size_t j = kept; j-- > 0 && nodes[j].value == node.value;) {
+                    if ((seen = nodes[j].board.hash == node.board.hash)) break;
+                }
+                if (!seen) nodes[kept++] = node;
+            }
+        }
+        nodes.resize(kept);
+    }
+
+    // Children of every beam node with the k-th queued piece, into ranked
+    void expandLayer(int k) {
+        layer = k + 1;      // upcoming[layer] follows this layer's piece
+        layerType = upcoming[k];
+        nextNode = 0;
+        for (auto& worker : workers) worker->children.clear();
+
+        if (threads.empty()) {
+            work(0);
+        } else {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                ++generation;
+                busy = static_cast<int>(threads.size());
+            }
+            wake.notify_all();
+            work(0);
+            std::unique_lock<std::mutex> guard(lock);
+            finished.wait(guard, [this] { return busy == 0; });
+        }
+
+        ranked.clear();
+        for (auto& worker : workers) {
+            ranked.insert(ranked.end(), worker->children.begin(), worker->children.end());
+        }
+    }
+
+    void work(int index) {
+        Worker& worker = *workers[index];
+        int total = static_cast<int>(beam.size());
+        for (int i; (i = nextNode.fetch_add(1)) < total;) {
+            expand(worker, i);
+        }
+    }
+
+    // Children of beam[i], from the cache when this state was expanded
+    // before (in any search); order numbers the children the same way
+    // either way
+    void expand(Worker& worker, int i) {
+        const SearchNode& parent = beam[i];
+        uint64_t key = SearchBoard::Keys::key(parent.board.hash, layerType, upcoming[layer]);
+        CachedChild* cached = worker.cached;
+
+        int count = cache.probe(key, cached);
+        if (count < 0) {
+            count = 0;
+            int placements = worker.gen.generate(parent.board.rows, Engine::spawnPiece(layerType));
+            for (int j = 0; j < placements; ++j) {
+                const Placement& p = worker.gen.placements[j];
+                if (p.y < 0) continue;  // tops out
+                SearchBoard board = parent.board;
+                board.place(MoveGenerator::toPiece(layerType, p));
+                board.clearLines();
+                if (count < MoveGenerator::MAX_PLACEMENTS) {
+                    cached[count++] = {p.x, p.y, p.rotation,
+                                       static_cast<float>(evaluateBoard<Width>(board.rows, weights))};
+                }
+            }
+            cache.store(key, cached, count);
+        }
+
+        for (int j = 0; j < count; ++j) {
+            SearchNode child;
+            child.board = parent.board;
+            Placement p{cached[j].x, cached[j].y, cached[j].rotation};
+            child.board.place(MoveGenerator::toPiece(layerType, p));
+            child.lines = parent.lines + child.board.clearLines();
+            child.value = score(child, cached[j].score);
+            child.root = parent.root;
+            child.order = static_cast<uint32_t>(i * MoveGenerator::MAX_PLACEMENTS + j);
+            worker.children.push_back(child);
+        }
+    }
+
+    void threadMain(int index) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            work(index);
+            std::lock_guard<std::mutex> guard(lock);
+            if (--busy == 0) finished.notify_one();
+        }
+    }
+};
+
+using AutoPlayer = BasicAutoPlayer<DEFAULT_BOARD_WIDTH, DEFAULT_BOARD_HEIGHT>;
@@ -0,0 +1,421 @@
+// tetris-bench: microbenchmarks for the engine and frame hot paths, run on
+// generated board fixtures (empty, half full, tall stack with holes). Each
+// benchmark reports ns/op and heap allocations per op, as a table or as
+// JSON (--json) so the numbers of two revisions can be diffed.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "autoplay.h"
+#include "compositor.h"
+#include "engine.h"
+#include "frame.h"
+#include "renderer.h"
+#include "snapshot.h"
+
+using namespace std;
+
+// ---------- allocation counting ----------
+
+// Every heap allocation in the process goes through these. The deletes
+// stay out of line: inlined, GCC flags free() on operator new's pointers.
+static atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// Keeps a result alive so the compiler cannot drop the work producing it
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// ---------- fixtures ----------
+
+struct Fixture {
+    string name;
+    Board board;
+};
+
+// Rows from `top` down filled at random, with at least one hole per row so
+// nothing is cleared; holeRate of the cells are left empty
+Board stackedBoard(mt19937& rng, int top, double holeRate) {
+    static const char SYMBOLS[] = "IOTSZJL";
+    Board board;
+    board.init();
+    uniform_real_distribution<double> chance(0.0, 1.0);
+    uniform_int_distribution<int> column(0, Board::WIDTH - 1);
+    for (int y = top; y < Board::HEIGHT; ++y) {
+        int hole = column(rng);
+        for (int x = 0; x < Board::WIDTH; ++x) {
+            if (x == hole || chance(rng) < holeRate) continue;
+            board.lockCell(y, x, SYMBOLS[rng() % 7]);
+        }
+    }
+    return board;
+}
+
+vector<Fixture> makeFixtures() {
+    mt19937 rng(1);
+    vector<Fixture> fixtures(3);
+    fixtures[0].name = "empty";
+    fixtures[0].board.init();
+    fixtures[1].name = "half";
+    fixtures[1].board = stackedBoard(rng, Board::HEIGHT / 2, 0.1);
+    fixtures[2].name = "tall";
+    fixtures[2].board = stackedBoard(rng, 3, 0.3);
+    return fixtures;
+}
+
+// Pieces spread over the fixture: every type and rotation, at columns and
+// heights where they fit (above the stack, or in its holes)
+vector<Piece> probePieces(const Board& board, int count) {
+    mt19937 rng(2);
+    vector<Piece> pieces;
+    while (static_cast<int>(pieces.size()) < count) {
+        Piece piece;
+        piece.type = static_cast<int>(rng() % 7);
+        piece.rotation = static_cast<int>(rng() % 4);
+        piece.pos = Position(static_cast<int>(rng() % (Board::WIDTH + 2)) - 2,
+                             static_cast<int>(rng() % (Board::HEIGHT + 1)) - 1);
+        if (!board.collides(BlockTemplate::rowMasks(piece.type, piece.rotation),
+                            piece.pos.x, piece.pos.y)) {
+            pieces.push_back(piece);
+        }
+    }
+    return pieces;
+}
+
+// Engine with a fixed queue, playing on the fixture's board
+Engine fixtureEngine(const Board& board) {
+    Engine engine;
+    engine.configure(Randomizer::Bag7, 5);
+    engine.seed(1);
+    engine.reset();
+    engine.board = board;
+    return engine;
+}
+
+// ---------- measurement ----------
+
+struct BenchResult {
+    string name;
+    string fixture;
+    long ops{0};
+    double nsPerOp{0};
+    double allocsPerOp{0};
+};
+
+struct BenchConfig {
+    double minSeconds{0.2};     // per timed run
+    int repeat{3};              // timed runs, the fastest is reported
+    string filter;              // only benchmarks whose name contains this
+    string jsonPath;            // "-" = stdout
+};
+
+// body(n) performs n ops. The op count doubles until one run takes
+// minSeconds; then `repeat` runs of that size are timed.
+BenchResult measure(const BenchConfig& config, const string& name, const string& fixture,
+                    const function<void(long)>& body) {
+    using Clock = chrono::steady_clock;
+    auto run = [&](long n) {
+        auto start = Clock::now();
+        body(n);
+        return chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    long ops = 1;
+    while (run(ops) < config.minSeconds && ops < (1L << 40)) {
+        ops *= 2;
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.fixture = fixture;
+    result.ops = ops;
+    result.nsPerOp = 1e300;
+    for (int r = 0; r < config.repeat; ++r) {
+        uint64_t before = allocations.load(memory_order_relaxed);
+        double seconds = run(ops);
+        uint64_t allocated = allocations.load(memory_order_relaxed) - before;
+        result.nsPerOp = min(result.nsPerOp, seconds * 1e9 / ops);
+        result.allocsPerOp = static_cast<double>(allocated) / ops;
+    }
+    return result;
+}
+
+// ---------- benchmarks ----------
+
+struct BenchSuite {
+    const BenchConfig& config;
+    vector<BenchResult> results;
+
+    explicit BenchSuite(const BenchConfig& cfg) : config(cfg) {}
+
+    void add(const string& name, const string& fixture, const function<void(long)>& body) {
+        if (!config.filter.empty() && name.find(config.filter) == string::npos) return;
+        results.push_back(measure(config, name, fixture, body));
+        const BenchResult& r = results.back();
+        fprintf(stderr, "%-20s %-6s %12.1f ns/op %8.2f allocs/op\n",
+                r.name.c_str(), r.fixture.c_str(), r.nsPerOp, r.allocsPerOp);
+    }
+
+    void run() {
+        static constexpr int PROBES = 64;   // power of two
+
+        for (const Fixture& fixture : makeFixtures()) {
+            const string& at = fixture.name;
+            Engine engine = fixtureEngine(fixture.board);
+            vector<Piece> pieces = probePieces(fixture.board, PROBES);
+
+            add("canMove", at, [&](long n) {
+                for (long i = 0; i < n; ++i) {
+                    engine.currentPiece = pieces[i & (PROBES - 1)];
+                    keep(engine.canMove(0, 1, (engine.currentPiece.rotation + 1) & 3));
+                }
+            });
+
+            add("calculateGhostPiece", at, [&](long n) {
+                for (long i = 0; i < n; ++i) {
+                    engine.currentPiece = pieces[i & (PROBES - 1)];
+                    keep(engine.calculateGhostPiece());
+                }
+            });
+
+            // The board copy alone, to subtract from clearLines
+            add("boardCopy", at, [&](long n) {
+                for (long i = 0; i < n; ++i) {
+                    Board board = fixture.board;
+                    keep(board);
+                }
+            });
+
+            // The bottom four rows completed, as after a tetris
+            Board full = fixture.board;
+            for (int y = Board::HEIGHT - 4; y < Board::HEIGHT; ++y) {
+                for (int x = 0; x < Board::WIDTH; ++x) {
+                    if (!full.isOccupied(y, x)) full.lockCell(y, x, '#');
+                }
+            }
+            add("clearLines", at, [&](long n) {
+                for (long i = 0; i < n; ++i) {
+                    Board board = full;
+                    keep(board.clearLines());
+                    keep(board);
+                }
+            });
+
+            // Snapshot encode and decode in memory; the file itself is a
+            // single read or an fsync'ed rename. restore decodes a snapshot
+            // taken here, so it times a full decode whatever ran before it.
+            Snapshot saved;
+            saved.capture(engine, 0);
+            Engine restored;
+            uint32_t ticks = 0;
+            if (!saved.restore(restored, ticks)) {
+                fprintf(stderr, "snapshot of fixture %s does not restore\n", at.c_str());
+                exit(1);
+            }
+
+            add("snapshot.capture", at, [&](long n) {
+                Snapshot snapshot;
+                for (long i = 0; i < n; ++i) {
+                    snapshot.capture(engine, static_cast<uint32_t>(i));
+                    keep(snapshot.bytes);
+                }
+            });
+
+            add("snapshot.restore", at, [&](long n) {
+                for (long i = 0; i < n; ++i) {
+                    keep(saved.restore(restored, ticks));
+                    keep(restored.board);
+                }
+            });
+
+            // The frontend's per-frame work: compose the layers, assemble
+            // the text rows, encode the difference to the previous frame
+            Compositor<Board::WIDTH, Board::HEIGHT> compositor;
+            FrameBuilder<Board::WIDTH, Board::HEIGHT> frame;
+            TerminalRenderer renderer;
+            auto compose = [&](long i) {
+                const Piece& piece = pieces[i & (PROBES - 1)];
+                engine.currentPiece = piece;
+                compositor.lockedLayer(engine.board);
+                compositor.ghostLayer(engine.calculateGhostPiece());
+                compositor.pieceLayer(piece);
+            };
+
+            add("frame.compose", at, [&](long n) {
+                for (long i = 0; i < n; ++i) {
+                    compose(i);
+                    keep(compositor.field);
+                }
+            });
+
+            add("frame.assemble", at, [&](long n) {
+                for (long i = 0; i < n; ++i) {
+                    compose(i);
+                    frame.assemble(compositor.field, engine);
+                    keep(frame.rows);
+                }
+            });
+
+            add("frame.encode", at, [&](long n) {
+                for (long i = 0; i < n; ++i) {
+                    compose(i);
+                    frame.assemble(compositor.field, engine);
+                    renderer.encode(frame.rows);
+                    keep(renderer.out);
+                }
+            });
+
+            // The whole frame as the game does it, written to /dev/null
+            int devNull = open("/dev/null", O_WRONLY);
+            if (devNull >= 0) {
+                renderer.fd = devNull;
+                add("frame.present", at, [&](long n) {
+                    for (long i = 0; i < n; ++i) {
+                        compose(i);
+                        frame.assemble(compositor.field, engine);
+                        renderer.present(frame.rows);
+                    }
+                });
+                close(devNull);
+            }
+        }
+
+        add("getCell", "-", [&](long n) {
+            for (long i = 0; i < n; ++i) {
+                // type, rotation, row and column from the low bits of i
+                int type = static_cast<int>((i >> 6) % 7);
+                keep(BlockTemplate::getCell(type, (i >> 4) & 3, (i >> 2) & 3, i & 3));
+            }
+        });
+
+        // Whole games, one op per tick: random inputs as in tetris-sim's
+        // random policy, a new game after each top out
+        add("game.tick", "-", [&](long n) {
+            static const Action ACTIONS[] = {
+                Action::None, Action::None, Action::MoveLeft, Action::MoveRight,
+                Action::Rotate, Action::Down, Action::HardDrop
+            };
+            Engine engine;
+            engine.seed(1);
+            engine.reset();
+            mt19937 rng(1);
+            for (long i = 0; i < n; ++i) {
+                StepResult step = engine.tick(ACTIONS[rng() % 7], false);
+                if (step.gameOver) engine.reset();
+            }
+            keep(engine.state);
+        });
+
+        // Whole games played by the AI, one op per piece
+        add("game.autoplay", "-", [&](long n) {
+            Engine engine;
+            engine.configure(Randomizer::Bag7, 5);
+            engine.seed(1);
+            engine.reset();
+            AutoPlayer bot(1);
+            Action path[AutoPlayer::MAX_PATH];
+            for (long i = 0; i < n; ++i) {
+                int length = bot.planPath(engine, path, AutoPlayer::MAX_PATH);
+                for (int k = 0; k < length; ++k) engine.step(path[k]);
+                if (!engine.state.running) engine.reset();
+            }
+            keep(engine.state);
+        });
+    }
+};
+
+// ---------- reporting ----------
+
+void printTable(const vector<BenchResult>& results) {
+    printf("%-20s %-7s %14s %12s %12s\n", "benchmark", "fixture", "ns/op", "allocs/op", "ops");
+    for (const BenchResult& r : results) {
+        printf("%-20s %-7s %14.1f %12.2f %12ld\n",
+               r.name.c_str(), r.fixture.c_str(), r.nsPerOp, r.allocsPerOp, r.ops);
+    }
+}
+
+// One benchmark per line, so two result files diff line by line
+bool writeJson(const string& path, const BenchConfig& config, const vector<BenchResult>& results) {
+    FILE* out = path == "-" ? stdout : fopen(path.c_str(), "w");
+    if (!out) return false;
+
+    fprintf(out, "{\n  \"min_time_ms\": %.0f,\n  \"repeat\": %d,\n  \"benchmarks\": [\n",
+            config.minSeconds * 1000, config.repeat);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"fixture\": \"%s\", \"ns_per_op\": %.2f, "
+                     "\"allocs_per_op\": %.3f, \"ops\": %ld}%s\n",
+                r.name.c_str(), r.fixture.c_str(), r.nsPerOp, r.allocsPerOp, r.ops,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    bool ok = !ferror(out);
+    if (out != stdout) ok = fclose(out) == 0 && ok;
+    return ok;
+}
+
+void printUsage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--json FILE|-] [--filter TEXT] [--min-time MS] [--repeat N]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json" && hasValue) {
+            config.jsonPath = argv[++i];
+        } else if (arg == "--filter" && hasValue) {
+            config.filter = argv[++i];
+        } else if (arg == "--min-time" && hasValue) {
+            config.minSeconds = atof(argv[++i]) / 1000.0;
+        } else if (arg == "--repeat" && hasValue) {
+            config.repeat = atoi(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (config.minSeconds <= 0 || config.repeat <= 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    BenchSuite suite(config);
+    suite.run();
+
+    if (config.jsonPath.empty()) {
+        printTable(suite.results);
+    } else if (!writeJson(config.jsonPath, config, suite.results)) {
+        fprintf(stderr, "cannot write %s\n", config.jsonPath.c_str());
+        return 1;
+    }
+    return 0;
+}
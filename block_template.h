@@ -0,0 +1,138 @@
+#pragma once
+
+#include "board.h"
+
+// Base tetromino shapes in rotation 0 (I, O, T, S, Z, J, L)
+constexpr int TETROMINOES[NUM_BLOCK_TYPES][BLOCK_SIZE][BLOCK_SIZE] = {
+    // I
+    {
+        {0,1,0,0},
+        {0,1,0,0},
+        {0,1,0,0},
+        {0,1,0,0}
+    },
+    // O
+    {
+        {0,0,0,0},
+        {0,1,1,0},
+        {0,1,1,0},
+        {0,0,0,0}
+    },
+    // T
+    {
+        {0,0,0,0},
+        {0,1,0,0},
+        {1,1,1,0},
+        {0,0,0,0}
+    },
+    // S
+    {
+        {0,0,0,0},
+        {0,1,1,0},
+        {1,1,0,0},
+        {0,0,0,0}
+    },
+    // Z
+    {
+        {0,0,0,0},
+        {1,1,0,0},
+        {0,1,1,0},
+        {0,0,0,0}
+    },
+    // J
+    {
+        {0,0,0,0},
+        {1,0,0,0},
+        {1,1,1,0},
+        {0,0,0,0}
+    },
+    // L
+    {
+        {0,0,0,0},
+        {0,0,1,0},
+        {1,1,1,0},
+        {0,0,0,0}
+    }
+};
+
+constexpr char BLOCK_NAMES[NUM_BLOCK_TYPES] = {'I','O','T','S','Z','J','L'};
+
+constexpr int CELLS_PER_PIECE = 4;
+
+struct Cell {
+    int8_t row{}, col{};
+};
+
+// One tetromino in one rotation, fully precomputed
+struct Shape {
+    char grid[BLOCK_SIZE][BLOCK_SIZE]{};   // symbol or ' '
+    Cell cells[CELLS_PER_PIECE]{};         // occupied cells, row-major
+    PieceMask rowMasks[BLOCK_SIZE]{};      // bit j = column j
+    int8_t minRow{}, maxRow{}, minCol{}, maxCol{}; // bounding box in the 4x4
+    int8_t colBottom[BLOCK_SIZE]{-1, -1, -1, -1};  // lowest filled row per column
+};
+
+struct ShapeTable {
+    Shape shapes[NUM_BLOCK_TYPES][4]{};
+};
+
+// rotation: 0-3 (90° steps clockwise), applied to the base template
+constexpr ShapeTable buildShapeTable() {
+    ShapeTable table{};
+    for (int type = 0; type < NUM_BLOCK_TYPES; ++type) {
+        for (int rot = 0; rot < 4; ++rot) {
+            Shape& shape = table.shapes[type][rot];
+            shape.minRow = shape.minCol = BLOCK_SIZE;
+            shape.maxRow = shape.maxCol = -1;
+            int n = 0;
+
+            for (int row = 0; row < BLOCK_SIZE; ++row) {
+                for (int col = 0; col < BLOCK_SIZE; ++col) {
+                    int r = row;
+                    int c = col;
+                    for (int i = 0; i < rot; ++i) {
+                        int temp = 3 - c;
+                        c = r;
+                        r = temp;
+                    }
+
+                    bool filled = TETROMINOES[type][r][c] != 0;
+                    shape.grid[row][col] = filled ? BLOCK_NAMES[type] : ' ';
+                    if (!filled) continue;
+
+                    shape.cells[n].row = static_cast<int8_t>(row);
+                    shape.cells[n].col = static_cast<int8_t>(col);
+                    ++n;
+                    shape.rowMasks[row] |= static_cast<PieceMask>(1u << col);
+                    shape.colBottom[col] = static_cast<int8_t>(row);
+                    if (row < shape.minRow) shape.minRow = static_cast<int8_t>(row);
+                    if (row > shape.maxRow) shape.maxRow = static_cast<int8_t>(row);
+                    if (col < shape.minCol) shape.minCol = static_cast<int8_t>(col);
+                    if (col > shape.maxCol) shape.maxCol = static_cast<int8_t>(col);
+                }
+            }
+        }
+    }
+    return table;
+}
+
+struct BlockTemplate {
+    // All 7x4 rotated shapes, generated at compile time
+    static constexpr ShapeTable TABLE = buildShapeTable();
+
+    static constexpr const Shape& shape(int type, int rotation) {
+        return TABLE.shapes[type][rotation];
+    }
+
+    static constexpr char getCell(int type, int rotation, int row, int col) {
+        return TABLE.shapes[type][rotation].grid[row][col];
+    }
+
+    static constexpr const PieceMask* rowMasks(int type, int rotation) {
+        return TABLE.shapes[type][rotation].rowMasks;
+    }
+};
+
+static_assert(BlockTemplate::getCell(0, 1, 1, 0) == 'I', "I rotates to horizontal");
+static_assert(BlockTemplate::shape(1, 3).rowMasks[1] == 0x6, "O is rotation invariant");
+static_assert(BlockTemplate::shape(0, 0).colBottom[1] == 3, "vertical I reaches row 3");
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Board dimensions are template parameters, so each size gets its own
+// collision and line clear code with constant loop bounds and row masks
+// of the narrowest type that holds a row. The frontend instantiates a few
+// sizes and picks one at startup; this is the one used when none is given.
+constexpr int DEFAULT_BOARD_WIDTH  = 15;
+constexpr int DEFAULT_BOARD_HEIGHT = 20;
+
+constexpr int BLOCK_SIZE       = 4;
+constexpr int NUM_BLOCK_TYPES  = 7;
+
+// Unsigned integer of at least Bits bits (16 at the least)
+template <int Bits>
+using UintFor = std::conditional_t<(Bits <= 16), uint16_t,
+                std::conditional_t<(Bits <= 32), uint32_t, uint64_t>>;
+
+// One row of a 4x4 piece shape, bit j = piece column j
+using PieceMask = uint8_t;
+
+constexpr uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Zobrist hashing: a board hashes to the XOR of a fixed random key per
+// locked cell, so locking a cell is one XOR. Row keys are also tabulated
+// per byte of a row mask, which makes moving a whole row during a line
+// clear a few lookups instead of one per cell.
+template <int Width, int Height>
+struct ZobristTable {
+    static constexpr int ROW_BYTES = (Width + 7) / 8;
+
+    uint64_t cells[Height][Width]{};
+    uint64_t rowBytes[Height][ROW_BYTES][256]{};
+    uint64_t pieces[2][NUM_BLOCK_TYPES]{};     // [0] piece to place, [1] the one after
+
+    // Filled at startup: the large boards' tables are too big to build
+    // at compile time
+    ZobristTable() {
+        uint64_t state = 0x5DEECE66Dull;
+        for (int y = 0; y < Height; ++y) {
+            for (int x = 0; x < Width; ++x) cells[y][x] = splitMix64(state);
+            for (int byte = 0; byte < ROW_BYTES; ++byte) {
+                for (int bits = 0; bits < 256; ++bits) {
+                    uint64_t key = 0;
+                    for (int j = 0; j < 8; ++j) {
+                        int x = byte * 8 + j;
+                        if ((bits >> j) & 1 && x < Width) key ^= cells[y][x];
+                    }
+                    rowBytes[y][byte][bits] = key;
+                }
+            }
+        }
+        for (int i = 0; i < 2; ++i) {
+            for (int type = 0; type < NUM_BLOCK_TYPES; ++type) pieces[i][type] = splitMix64(state);
+        }
+    }
+};
+
+template <int Width, int Height>
+struct Zobrist {
+    static inline const ZobristTable<Width, Height> TABLE{};
+
+    static uint64_t cell(int y, int x) {
+        return TABLE.cells[y][x];
+    }
+
+    // All locked cells of one row
+    template <typename Mask>
+    static uint64_t row(int y, Mask mask) {
+        uint64_t key = 0;
+#pragma GCC unroll 4
+        for (int byte = 0; byte < ZobristTable<Width, Height>::ROW_BYTES; ++byte) {
+            key ^= TABLE.rowBytes[y][byte][(mask >> (8 * byte)) & 0xFF];
+        }
+        return key;
+    }
+
+    // A search state: board plus the piece to place and the one after
+    // (-1 when there is none)
+    static uint64_t key(uint64_t boardHash, int current, int next) {
+        return boardHash ^ (current >= 0 ? TABLE.pieces[0][current] : 0) ^
+               (next >= 0 ? TABLE.pieces[1][next] : 0);
+    }
+};
+
+template <int Width, int Height>
+struct BasicBoard {
+    static constexpr int WIDTH = Width;
+    static constexpr int HEIGHT = Height;
+    static_assert(Width >= BLOCK_SIZE && Width <= 32, "row masks hold at most 32 columns");
+    static_assert(Height >= BLOCK_SIZE && Height < 128, "rows fit in int8_t piece positions");
+
+    // One bit per column (bit j = column j), one mask per board row
+    using RowMask = UintFor<Width>;
+    static constexpr RowMask FULL_ROW = static_cast<RowMask>((uint64_t{1} << Width) - 1);
+
+    // A piece row shifted into board columns, with room for the bits that
+    // stick out past the right wall
+    using WideMask = UintFor<(Width + BLOCK_SIZE > 32 ? 64 : 32)>;
+
+    using Keys = Zobrist<Width, Height>;
+
+    // Occupancy bitboard: bit j of rows[i] is set when cell (i, j) is locked.
+    // This is the only thing collision checks and line clears look at.
+    RowMask rows[Height]{};
+
+    // Color plane, used for rendering only (block letter, '#' or ' ')
+    char grid[Height][Width]{};
+
+    // Skyline: row of the topmost locked cell per column, Height for an
+    // empty column. Kept up to date by lockCell() and clearLines().
+    uint8_t columnTop[Width]{};
+
+    // Bumped on every change to the locked cells, so derived data (such as
+    // the ghost piece) can be cached against it
+    uint32_t revision{0};
+
+    // Zobrist hash of the locked cells, kept up to date by lockCell() and
+    // clearLines()
+    uint64_t hash{0};
+
+    void init() {
+        // Initialize entire grid as empty spaces
+        for (int i = 0; i < Height; ++i) {
+            rows[i] = 0;
+            for (int j = 0; j < Width; ++j) {
+                grid[i][j] = ' ';
+            }
+        }
+        for (int j = 0; j < Width; ++j) {
+            columnTop[j] = Height;
+        }
+        hash = 0;
+        ++revision;
+    }
+
+    bool isOccupied(int y, int x) const {
+        return (rows[y] >> x) & 1u;
+    }
+
+    void lockCell(int y, int x, char symbol) {
+        if (!isOccupied(y, x)) hash ^= Keys::cell(y, x);
+        rows[y] |= static_cast<RowMask>(RowMask{1} << x);
+        grid[y][x] = symbol;
+        if (y < columnTop[x]) columnTop[x] = static_cast<uint8_t>(y);
+        ++revision;
+    }
+
+    // Test a 4-row piece (one mask per piece row, bit j = piece column j)
+    // placed with its top-left corner at (x, y) against walls, floor and
+    // locked blocks. Rows above the board (y < 0) only check the walls.
+    bool collides(const PieceMask pieceRows[BLOCK_SIZE], int x, int y) const {
+#pragma GCC unroll 4
+        for (int i = 0; i < BLOCK_SIZE; ++i) {
+            WideMask m = pieceRows[i];
+            if (m == 0) continue;
+
+            // Shift piece row into board columns, catching the left wall
+            if (x < 0) {
+                if (m & ((WideMask{1} << -x) - 1)) return true;
+                m >>= -x;
+            } else {
+                m <<= x;
+            }
+
+            // Right wall
+            if (m & ~static_cast<WideMask>(FULL_ROW)) return true;
+
+            int yt = y + i;
+            if (yt >= Height) return true;
+            if (yt >= 0 && (rows[yt] & m)) return true;
+        }
+        return false;
+    }
+
+    int clearLines() {
+        int writeRow = Height - 1;
+        int linesCleared = 0;
+
+        // Scan from bottom to top
+        for (int readRow = Height - 1; readRow >= 0; --readRow) {
+            // Keep non-full rows, skip full ones
+            if (rows[readRow] != FULL_ROW) {
+                if (writeRow != readRow) {
+                    hash ^= Keys::row(readRow, rows[readRow]) ^
+                            Keys::row(writeRow, rows[readRow]);
+                    rows[writeRow] = rows[readRow];
+                    std::memcpy(grid[writeRow], grid[readRow], Width);
+                }
+                --writeRow;
+            } else {
+                hash ^= Keys::row(readRow, FULL_ROW);
+                ++linesCleared;
+            }
+        }
+
+        // Clear remaining top rows
+        while (writeRow >= 0) {
+            rows[writeRow] = 0;
+            std::memset(grid[writeRow], ' ', Width);
+            --writeRow;
+        }
+
+        if (linesCleared > 0) {
+            updateSkyline();
+            ++revision;
+        }
+        return linesCleared;
+    }
+
+    // Push the stack up by count rows and fill the bottom with garbage:
+    // full rows except for the hole column. One memmove per plane, then
+    // the hash and skyline are rebuilt. Returns false when locked cells
+    // were pushed off the top.
+    bool insertGarbage(int count, int hole) {
+        if (count <= 0) return true;
+        if (count > Height) count = Height;
+
+        bool overflow = false;
+        for (int y = 0; y < count; ++y) overflow |= rows[y] != 0;
+        std::memmove(rows, rows + count, (Height - count) * sizeof(RowMask));
+        std::memmove(grid, grid + count, (Height - count) * sizeof(grid[0]));
+
+        RowMask garbage = static_cast<RowMask>(FULL_ROW & ~(RowMask{1} << hole));
+        for (int y = Height - count; y < Height; ++y) {
+            rows[y] = garbage;
+            std::memset(grid[y], '#', Width);
+            grid[y][hole] = ' ';
+        }
+
+        hash = 0;
+        for (int y = 0; y < Height; ++y) {
+            if (rows[y]) hash ^= Keys::row(y, rows[y]);
+        }
+        updateSkyline();
+        ++revision;
+        return !overflow;
+    }
+
+    // Rebuild columnTop from the row masks, top row first, stopping as soon
+    // as every column has been seen
+    void updateSkyline() {
+        RowMask pending = FULL_ROW;
+        for (int y = 0; y < Height && pending; ++y) {
+            RowMask found = rows[y] & pending;
+            pending &= static_cast<RowMask>(~found);
+            while (found) {
+                columnTop[__builtin_ctz(found)] = static_cast<uint8_t>(y);
+                found &= static_cast<RowMask>(found - 1);
+            }
+        }
+        while (pending) {
+            columnTop[__builtin_ctz(pending)] = Height;
+            pending &= static_cast<RowMask>(pending - 1);
+        }
+    }
+};
+
+using Board = BasicBoard<DEFAULT_BOARD_WIDTH, DEFAULT_BOARD_HEIGHT>;
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <sys/socket.h>
+
+#include "renderer.h"
+
+// Spectators: any number of viewers watching one game. Each frame is
+// encoded once, as a diff from the frame before it, into a shared buffer
+// that every viewer sends from - the bytes are not copied per viewer. A
+// viewer still sending an older frame when newer ones are published skips
+// them and gets a keyframe (the whole screen) next, so a slow viewer never
+// holds up the game and never builds up a backlog.
+
+struct EncodedFrame {
+    uint64_t sequence{0};
+    std::vector<char> bytes;
+};
+
+using SharedFrame = std::shared_ptr<const EncodedFrame>;
+
+struct Broadcast {
+    static constexpr char CLEAR_SCREEN[] = "\033[2J\033[1;1H";
+
+    TerminalRenderer encoder;   // diffs against the last published frame
+    uint64_t sequence{0};       // number of the latest frame, 0 = none yet
+    SharedFrame delta;          // latest frame as a diff from the one before
+    SharedFrame keyframe;       // latest frame in full, built on demand
+    std::vector<int> viewers;   // sockets watching; the server owns them
+
+    void publish(const TextFrame& rows) {
+        encoder.encode(rows);
+        if (encoder.out.empty()) return;
+
+        auto frame = std::make_shared<EncodedFrame>();
+        frame->sequence = ++sequence;
+        frame->bytes.assign(encoder.out.data, encoder.out.data + encoder.out.size);
+        delta = std::move(frame);
+        keyframe.reset();
+    }
+
+    // What a viewer showing frame `shown` sends next: the diff when it has
+    // the frame before the latest, the whole screen when it is further
+    // behind, null when it is up to date
+    SharedFrame frameAfter(uint64_t shown) {
+        if (shown == sequence) return nullptr;
+        if (shown + 1 == sequence) return delta;
+        if (!keyframe) {
+            // The encoder's presented frame is the latest one
+            const TextFrame& rows = encoder.presented;
+            auto frame = std::make_shared<EncodedFrame>();
+            frame->sequence = sequence;
+            frame->bytes.assign(CLEAR_SCREEN, CLEAR_SCREEN + sizeof(CLEAR_SCREEN) - 1);
+            for (int row = 0; row < rows.count; ++row) {
+                const TextFrame::Line& line = rows.lines[row];
+                frame->bytes.insert(frame->bytes.end(), line.data, line.data + line.size);
+                frame->bytes.push_back('\n');
+            }
+            keyframe = std::move(frame);
+        }
+        return keyframe;
+    }
+};
+
+// One viewer's socket and how far it is through the frame it is sending
+struct Viewer {
+    int fd{-1};
+    SharedFrame frame;          // being sent, shared with the other viewers
+    size_t sent{0};
+    uint64_t shown{0};          // last frame sent completely
+
+    bool pendingOutput() const {
+        return frame && sent < frame->bytes.size();
+    }
+
+    // Starts over with a keyframe, e.g. for another game
+    void reset() {
+        frame.reset();
+        sent = 0;
+        shown = 0;
+    }
+
+    // Sends what the socket takes, moving on to source's newer frames as
+    // each one is out; false on a connection error
+    bool pump(Broadcast& source) {
+        for (;;) {
+            if (!pendingOutput()) {
+                if (frame) shown = frame->sequence;
+                frame = source.frameAfter(shown);
+                sent = 0;
+                if (!frame) return true;
+            }
+            ssize_t n = ::send(fd, frame->bytes.data() + sent, frame->bytes.size() - sent,
+                               MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+};
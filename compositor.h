@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstring>
+
+#include "engine.h"
+
+// Frame composition. Board only stores locked cells; everything else that
+// shows on the playfield is painted over a copy of them, one layer at a
+// time, into a Playfield buffer that the frontend turns into text rows.
+// Layers, bottom to top: locked cells, ghost, falling piece. The side panel
+// is composed next to each row when the frame is assembled.
+
+template <int Width, int Height>
+struct Playfield {
+    static constexpr int WIDTH = Width;
+    static constexpr int HEIGHT = Height;
+
+    char cells[Height][Width]{};
+};
+
+template <int Width, int Height>
+struct Compositor {
+    using Board = BasicBoard<Width, Height>;
+
+    Playfield<Width, Height> field;
+
+    // Layer 1: the locked cells, copied from the board's color plane
+    void lockedLayer(const Board& board) {
+        static_assert(sizeof(field.cells) == sizeof(board.grid), "playfield matches board");
+        std::memcpy(field.cells, board.grid, sizeof(field.cells));
+    }
+
+    // Layer 2: ghost dots, on empty cells only
+    void ghostLayer(const Piece& ghost) {
+        paint(ghost, '.', false);
+    }
+
+    // Layer 3: the falling piece. With covering=false it only fills empty
+    // cells, which shows a piece that topped out without hiding the stack.
+    void pieceLayer(const Piece& piece, bool covering = true) {
+        paint(piece, 0, covering);
+    }
+
+    // symbol 0 paints the piece's own block letter
+    void paint(const Piece& piece, char symbol, bool covering) {
+        const Shape& shape = BlockTemplate::shape(piece.type, piece.rotation);
+        for (const Cell& c : shape.cells) {
+            int x = piece.pos.x + c.col;
+            int y = piece.pos.y + c.row;
+            if (y < 0 || y >= Height || x < 0 || x >= Width) {
+                continue;
+            }
+
+            char& cell = field.cells[y][x];
+            if (covering || cell == ' ') {
+                cell = symbol != 0 ? symbol : shape.grid[c.row][c.col];
+            }
+        }
+    }
+};
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <cstdint>
+
+#include "board.h"
+#include "block_template.h"
+#include "piece_generator.h"
+
+// Headless game rules: board, falling piece, scoring, level and spawning.
+// No terminal, clock or file access - a frontend feeds actions into step(),
+// or into tick() to also get gravity, at whatever rate it likes.
+
+struct Position {
+    int x{}, y{};
+    Position() = default;
+    Position(int _x, int _y) : x(_x), y(_y) {}
+};
+
+struct Piece {
+    int type{0};
+    int rotation{0};
+    Position pos{5, 0};
+};
+
+struct GameState {
+    bool running{true};       // false once the game is over
+    int score{0};
+    int level{1};
+    int linesCleared{0};
+};
+
+enum class Action : uint8_t {
+    None,
+    MoveLeft,
+    MoveRight,
+    Rotate,     // clockwise, with wall kicks
+    Down,       // one row down, locks when blocked (gravity and soft drop)
+    HardDrop,
+};
+
+struct StepResult {
+    bool moved{false};        // piece moved or rotated
+    bool locked{false};       // piece locked and the next one spawned
+    int linesCleared{0};      // rows removed by this lock
+    bool gameOver{false};
+};
+
+// Extended wall kick offsets to handle S/Z blocks near edges
+constexpr int WALL_KICKS[] = {0, -1, 1, -2, 2, -3, 3};
+
+// gameplay tuning
+constexpr int LOGIC_HZ            = 60;     // engine ticks per second
+constexpr int LOCK_DELAY_TICKS    = 30;     // grounded ticks before a piece locks
+
+// Gravity is fixed point: GRAVITY_ONE means one row per tick
+constexpr int32_t GRAVITY_ONE = 1 << 16;
+
+// Per-level gravity, from one row every 30 ticks (0.5 s) at level 1 down to
+// one row per tick, then several rows per tick and finally 20G, where
+// pieces land on the tick they spawn
+constexpr int32_t GRAVITY_TABLE[] = {
+    GRAVITY_ONE / 30, GRAVITY_ONE / 26, GRAVITY_ONE / 22, GRAVITY_ONE / 19,
+    GRAVITY_ONE / 16, GRAVITY_ONE / 13, GRAVITY_ONE / 11, GRAVITY_ONE / 9,
+    GRAVITY_ONE / 7,  GRAVITY_ONE / 6,  GRAVITY_ONE / 5,  GRAVITY_ONE / 4,
+    GRAVITY_ONE / 3,  GRAVITY_ONE / 2,  GRAVITY_ONE,      GRAVITY_ONE * 2,
+    GRAVITY_ONE * 3,  GRAVITY_ONE * 5,  GRAVITY_ONE * 20
+};
+constexpr int GRAVITY_LEVELS = sizeof(GRAVITY_TABLE) / sizeof(GRAVITY_TABLE[0]);
+
+// Soft drop falls at least 10 rows per second
+constexpr int32_t SOFT_DROP_GRAVITY = GRAVITY_ONE / 6;
+
+constexpr int32_t gravityForLevel(int level) {
+    return GRAVITY_TABLE[level < 1 ? 0
+                       : level > GRAVITY_LEVELS ? GRAVITY_LEVELS - 1
+                       : level - 1];
+}
+
+// Standard Tetris scoring: 1=40, 2=100, 3=300, 4=1200
+constexpr int LINE_SCORES[] = {0, 40, 100, 300, 1200};
+
+// Versus play: garbage rows sent to the opponent per lines cleared
+constexpr int GARBAGE_FOR_LINES[] = {0, 0, 1, 2, 4};
+
+template <int Width, int Height>
+struct BasicEngine {
+    using Board = BasicBoard<Width, Height>;
+
+    Board board;
+    GameState state;
+    Piece currentPiece{};
+    PieceQueue queue;         // upcoming pieces, queue.peek(0) spawns next
+    int32_t gravityAccum{0};  // fraction of a row fallen so far (GRAVITY_ONE = 1)
+    int lockTicks{0};         // ticks spent resting on the stack
+    int garbagePending{0};    // rows sent by an opponent, rise at the next lock
+    uint32_t garbageRng{1};   // xorshift state for the garbage hole column
+
+    void seed(uint32_t value) {
+        queue.generator.seed(value);
+        garbageRng = value | 1;
+    }
+
+    // Randomizer and preview depth take effect on the next reset()
+    void configure(Randomizer randomizer, int previewDepth) {
+        queue.generator.kind = randomizer;
+        queue.depth = previewDepth < 1 ? 1
+                    : previewDepth > PieceQueue::MAX_DEPTH ? PieceQueue::MAX_DEPTH
+                    : previewDepth;
+    }
+
+    // Start a new game; the RNG keeps its current stream
+    void reset() {
+        state = GameState{};
+        board.init();
+        gravityAccum = 0;
+        lockTicks = 0;
+        garbagePending = 0;
+
+        queue.reset();
+        spawnNewPiece();
+    }
+
+    StepResult step(Action action) {
+        StepResult result;
+        if (!state.running) {
+            result.gameOver = true;
+            return result;
+        }
+
+        switch (action) {
+            case Action::MoveLeft:
+                result.moved = tryMove(-1, 0, currentPiece.rotation);
+                break;
+            case Action::MoveRight:
+                result.moved = tryMove(1, 0, currentPiece.rotation);
+                break;
+            case Action::Rotate:
+                result.moved = rotate();
+                break;
+            case Action::Down:
+                if (tryMove(0, 1, currentPiece.rotation)) {
+                    result.moved = true;
+                } else {
+                    lockOrTopOut(result);
+                }
+                break;
+            case Action::HardDrop:
+                // Drop piece to the lowest possible position
+                while (tryMove(0, 1, currentPiece.rotation)) {
+                    result.moved = true;
+                }
+                lockOrTopOut(result);
+                break;
+            case Action::None:
+                break;
+        }
+
+        result.gameOver = !state.running;
+        return result;
+    }
+
+    // One logic tick (1/LOGIC_HZ s): apply the player's action, then gravity
+    // for the current level. A piece resting on the stack locks after
+    // LOCK_DELAY_TICKS ticks without falling.
+    StepResult tick(Action action, bool softDrop) {
+        StepResult result = step(action);
+        if (!state.running || result.locked) return result;
+
+        int32_t gravity = gravityForLevel(state.level);
+        if (softDrop && gravity < SOFT_DROP_GRAVITY) {
+            gravity = SOFT_DROP_GRAVITY;
+        }
+
+        gravityAccum += gravity;
+        while (gravityAccum >= GRAVITY_ONE) {
+            gravityAccum -= GRAVITY_ONE;
+            if (!tryMove(0, 1, currentPiece.rotation)) {
+                gravityAccum = 0;
+                break;
+            }
+            result.moved = true;
+            lockTicks = 0;
+        }
+
+        if (canMove(0, 1, currentPiece.rotation)) {
+            lockTicks = 0;
+        } else if (++lockTicks >= LOCK_DELAY_TICKS) {
+            lockOrTopOut(result);
+        }
+
+        result.gameOver = !state.running;
+        return result;
+    }
+
+    // ---------- queries ----------
+
+    // Calculate where the current piece would land if dropped straight down
+    Piece calculateGhostPiece() const {
+        Piece ghost = currentPiece;
+        ghost.pos.y = landingRow(currentPiece);
+        return ghost;
+    }
+
+    // Row the piece comes to rest on when dropped straight down. Normally
+    // read off the skyline in O(piece width): each piece column stops just
+    // above that column's top block. A piece tucked under an overhang is
+    // below the skyline, so it falls back to stepping down row by row.
+    int landingRow(const Piece& piece) const {
+        const Shape& shape = BlockTemplate::shape(piece.type, piece.rotation);
+        int landing = Height;
+        for (int c = shape.minCol; c <= shape.maxCol; ++c) {
+            int bottom = shape.colBottom[c];
+            if (bottom < 0) continue;
+
+            int top = board.columnTop[piece.pos.x + c];
+            if (piece.pos.y + bottom >= top) return scanLandingRow(piece);
+            if (top - 1 - bottom < landing) landing = top - 1 - bottom;
+        }
+        return landing;
+    }
+
+    int scanLandingRow(const Piece& piece) const {
+        const PieceMask* masks = BlockTemplate::rowMasks(piece.type, piece.rotation);
+        int y = piece.pos.y;
+
+        // Keep moving down until we hit the floor or a locked block
+        while (!board.collides(masks, piece.pos.x, y + 1)) {
+            ++y;
+        }
+        return y;
+    }
+
+    // Check if piece can spawn: verify bounds and no collision with existing blocks
+    bool canSpawn(const Piece& piece) const {
+        return !board.collides(BlockTemplate::rowMasks(piece.type, piece.rotation),
+                               piece.pos.x, piece.pos.y);
+    }
+
+    bool canMove(int dx, int dy, int newRotation) const {
+        return !board.collides(BlockTemplate::rowMasks(currentPiece.type, newRotation),
+                               currentPiece.pos.x + dx, currentPiece.pos.y + dy);
+    }
+
+    int nextPieceType() const {
+        return queue.peek(0);
+    }
+
+    // ---------- rules ----------
+
+    bool tryMove(int dx, int dy, int newRotation) {
+        if (!canMove(dx, dy, newRotation)) return false;
+        currentPiece.pos.x += dx;
+        currentPiece.pos.y += dy;
+        currentPiece.rotation = newRotation;
+        return true;
+    }
+
+    bool rotate() {
+        int newRot = (currentPiece.rotation + 1) % 4;
+        for (int dx : WALL_KICKS) {
+            if (tryMove(dx, 0, newRot)) return true;
+        }
+        return false;
+    }
+
+    // Permanently add the piece to the board (occupancy and color)
+    void lockPiece(const Piece& piece) {
+        lockPiece(board, piece);
+    }
+
+    static void lockPiece(Board& board, const Piece& piece) {
+        const Shape& shape = BlockTemplate::shape(piece.type, piece.rotation);
+        for (const Cell& c : shape.cells) {
+            int xt = piece.pos.x + c.col;
+            int yt = piece.pos.y + c.row;
+
+            if (yt < 0 || yt >= Height ||
+                xt < 0 || xt >= Width) {
+                continue;
+            }
+
+            board.lockCell(yt, xt, shape.grid[c.row][c.col]);
+        }
+    }
+
+    // Where a new piece of `type` appears: near horizontal center, above
+    // the visible board (y=-1), so it comes in from above the divider line
+    static Piece spawnPiece(int type) {
+        Piece piece;
+        piece.type = type;
+        piece.rotation = 0;
+        piece.pos = Position((Width / 2) - (BLOCK_SIZE / 2), -1);
+        return piece;
+    }
+
+    void spawnNewPiece() {
+        // Create temporary piece to test spawn
+        Piece testPiece = spawnPiece(queue.peek(0));
+
+        // Always set currentPiece so it can be displayed even on game over
+        currentPiece = testPiece;
+
+        // Check if spawn is possible - if blocks at y=0 collide, game over
+        if (!canSpawn(testPiece)) {
+            state.running = false;
+            return;
+        }
+
+        // Spawn is valid, take the piece off the queue (which tops it up)
+        queue.pop();
+    }
+
+    // Lock the current piece, clear lines, score and spawn the next piece.
+    // Returns the number of lines cleared.
+    int lockPieceAndCheck() {
+        // permanently place current piece
+        lockPiece(currentPiece);
+
+        // Clear lines and update score
+        int lines = board.clearLines();
+        if (lines > 0) {
+            state.linesCleared += lines;
+            state.score += LINE_SCORES[lines] * state.level;
+
+            // Level up every 10 lines
+            state.level = 1 + (state.linesCleared / 10);
+        } else if (garbagePending > 0) {
+            riseGarbage();
+        }
+
+        // Try to spawn next piece - if it fails, game over
+        spawnNewPiece();
+        return lines;
+    }
+
+    // ---------- versus ----------
+
+    // Garbage for a clear of `lines` first cancels rows queued against
+    // this player; returns the rows left to send to the opponent
+    int cancelGarbage(int lines) {
+        int attack = GARBAGE_FOR_LINES[lines];
+        int cancelled = attack < garbagePending ? attack : garbagePending;
+        garbagePending -= cancelled;
+        return attack - cancelled;
+    }
+
+    void queueGarbage(int rows) {
+        garbagePending += rows;
+    }
+
+    // The queued rows come up under the stack with one shared hole; blocks
+    // pushed off the top end the game
+    void riseGarbage() {
+        garbageRng ^= garbageRng << 13;
+        garbageRng ^= garbageRng >> 17;
+        garbageRng ^= garbageRng << 5;
+        int hole = static_cast<int>(garbageRng % Width);
+        if (!board.insertGarbage(garbagePending, hole)) state.running = false;
+        garbagePending = 0;
+    }
+
+    void lockOrTopOut(StepResult& result) {
+        // Don't lock if piece is still above visible board (y < 0)
+        // This means the board is full at the top - game over
+        if (currentPiece.pos.y < 0) {
+            state.running = false;
+            return;
+        }
+        result.locked = true;
+        result.linesCleared = lockPieceAndCheck();
+
+        // The new piece starts falling from scratch
+        gravityAccum = 0;
+        lockTicks = 0;
+    }
+};
+
+using Engine = BasicEngine<DEFAULT_BOARD_WIDTH, DEFAULT_BOARD_HEIGHT>;
+
+// Versus play: two engines ticked on one clock. Garbage is exchanged after
+// both have stepped, so neither player's result depends on which engine
+// ran first.
+template <typename GameEngine>
+void exchangeGarbage(GameEngine& first, const StepResult& firstResult,
+                     GameEngine& second, const StepResult& secondResult) {
+    int toSecond = first.cancelGarbage(firstResult.linesCleared);
+    int toFirst = second.cancelGarbage(secondResult.linesCleared);
+    second.queueGarbage(toSecond);
+    first.queueGarbage(toFirst);
+}
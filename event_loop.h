@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <poll.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+
+// Blocking wait for "input arrived" or "deadline reached", so the game
+// sleeps in the kernel between events instead of polling on a fixed sleep.
+// On Linux the deadline is a timerfd polled next to the input fd; elsewhere
+// it becomes the poll() timeout.
+
+inline int64_t monotonicNowNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+struct EventLoop {
+    enum : int {
+        WAKE_INPUT = 1,
+        WAKE_TIMER = 2,
+    };
+
+    static constexpr int64_t NO_DEADLINE = -1;
+
+    int inputFd{STDIN_FILENO};
+    int timerFd{-1};
+
+    EventLoop() {
+#ifdef __linux__
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+#endif
+    }
+
+    ~EventLoop() {
+        if (timerFd >= 0) close(timerFd);
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Block until input is readable and/or the absolute CLOCK_MONOTONIC
+    // deadline has passed. Returns a mask of WAKE_* flags.
+    int wait(int64_t deadlineNs) {
+        pollfd fds[2]{};
+        fds[0].fd = inputFd;
+        fds[0].events = POLLIN;
+        int count = 1;
+        int timeoutMs = -1;
+
+        if (deadlineNs != NO_DEADLINE) {
+            if (timerFd >= 0) {
+                armTimer(deadlineNs);
+                fds[1].fd = timerFd;
+                fds[1].events = POLLIN;
+                count = 2;
+            } else {
+                int64_t remaining = deadlineNs - monotonicNowNs();
+                timeoutMs = remaining <= 0 ? 0
+                          : static_cast<int>((remaining + 999999) / 1000000);
+            }
+        }
+
+        int ready = poll(fds, count, timeoutMs);
+        if (ready < 0 && errno == EINTR) {
+            ready = 0;  // e.g. SIGWINCH - callers simply re-evaluate
+        }
+
+        int wake = 0;
+        if (ready > 0 && (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            wake |= WAKE_INPUT;
+        }
+        if (count == 2 && (fds[1].revents & POLLIN)) {
+            uint64_t expirations = 0;
+            ssize_t n = read(timerFd, &expirations, sizeof(expirations));
+            (void)n;
+        }
+        if (deadlineNs != NO_DEADLINE && monotonicNowNs() >= deadlineNs) {
+            wake |= WAKE_TIMER;
+        }
+        return wake;
+    }
+
+    void armTimer(int64_t deadlineNs) {
+#ifdef __linux__
+        itimerspec spec{};
+        // A zero it_value disarms the timer, so clamp to 1 ns past epoch
+        if (deadlineNs <= 0) deadlineNs = 1;
+        spec.it_value.tv_sec = deadlineNs / 1000000000;
+        spec.it_value.tv_nsec = deadlineNs % 1000000000;
+        timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+#else
+        (void)deadlineNs;
+#endif
+    }
+};
+
+// Fixed-timestep scheduler on the monotonic clock. Logic always advances in
+// whole steps of stepNs, however late the wakeup was, so game time does not
+// stretch when a frame is slow. After a long stall (e.g. the process was
+// stopped) it skips ahead instead of replaying a burst of steps.
+struct FixedTimestep {
+    static constexpr int MAX_CATCH_UP_STEPS = 8;
+
+    int64_t stepNs{1};
+    int64_t nextStepNs{0};
+
+    void start(int64_t hz, int64_t nowNs) {
+        stepNs = 1000000000 / hz;
+        nextStepNs = nowNs + stepNs;
+    }
+
+    // Number of steps that are due at nowNs; the schedule advances past them
+    int due(int64_t nowNs) {
+        if (nowNs < nextStepNs) return 0;
+
+        int64_t steps = (nowNs - nextStepNs) / stepNs + 1;
+        if (steps > MAX_CATCH_UP_STEPS) {
+            nextStepNs = nowNs + stepNs;
+            return MAX_CATCH_UP_STEPS;
+        }
+        nextStepNs += steps * stepNs;
+        return static_cast<int>(steps);
+    }
+
+    int64_t deadline() const {
+        return nextStepNs;
+    }
+};
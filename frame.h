@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+
+#include "compositor.h"
+#include "engine.h"
+#include "renderer.h"
+
+// Frame assembly: turns a composed Playfield plus the game state into the
+// text rows of the game screen - borders and title, each playfield row with
+// its side panel row (next piece, stats, the rest of the queue) next to it,
+// and the controls line. No terminal I/O; the rows go to TerminalRenderer.
+// Built in place in fixed buffers, with no heap allocations.
+
+constexpr int NEXT_PICE_WIDTH  = 14;
+
+template <int Width, int Height>
+struct FrameBuilder {
+    using Engine = BasicEngine<Width, Height>;
+    static_assert(Height + 5 <= TextFrame::MAX_LINES, "frame fits in a TextFrame");
+
+    // Rebuilt in place every frame; the renderer compares it with what is
+    // on screen and sends only the changes
+    TextFrame rows;
+
+    void assemble(const Playfield<Width, Height>& field, const Engine& engine) {
+        rows.resize(Height + 5);
+        // Narrow boards get the short title
+        static constexpr char TITLE[] = "TETRIS GAME";
+        constexpr int titleLength = Width >= 11 ? static_cast<int>(sizeof(TITLE)) - 1 : 6;
+
+        // Top border (simple ASCII)
+        TextFrame::Line& border = rows.lines[0];
+        border.clear();
+        border.append('+');
+        border.append(Width, '-');
+        border.append('+');
+        border.append(NEXT_PICE_WIDTH, '-');
+        border.append('+');
+
+        // Title row
+        TextFrame::Line& titleLine = rows.lines[1];
+        int totalPadding = Width - titleLength;
+        int leftPad = totalPadding / 2;
+        int rightPad = totalPadding - leftPad;
+
+        titleLine.clear();
+        titleLine.append('|');
+        titleLine.append(leftPad, ' ');
+        titleLine.append(TITLE, titleLength);
+        titleLine.append(rightPad, ' ');
+        titleLine.append("|  NEXT PIECE  |");
+
+        // Divider
+        rows.lines[2].assign(border);
+
+        // Draw board rows with borders
+        for (int i = 0; i < Height; ++i) {
+            TextFrame::Line& line = rows.lines[3 + i];
+
+            // Left border, playfield cells, right border
+            line.clear();
+            line.append('|');
+            line.append(field.cells[i], Width);
+            line.append('|');
+
+            appendSidePanel(line, i, engine);
+        }
+
+        // Bottom border
+        rows.lines[Height + 3].assign(border);
+
+        TextFrame::Line& controls = rows.lines[Height + 4];
+        controls.clear();
+        controls.append("Controls: ←→ or A/D (Move)  ↑/W (Rotate)  ↓/S (Soft Drop)  SPACE (Hard Drop)  G (Ghost)  T (Timing)  P (Pause)  Q (Quit)");
+    }
+
+    // Side panel layer: next piece preview and stats, one row at a time
+    static void appendSidePanel(TextFrame::Line& line, int i, const Engine& engine) {
+        if (i == 0) {
+            line.append("              |");
+        } else if (i >= 1 && i <= 4) {
+            // Draw next piece preview line
+            line.append("     ");  // Left padding (5 spaces)
+            appendQueuedPieceRow(line, engine, 0, i - 1);  // 4 chars for the piece
+            line.append("     |");  // Right padding (5 spaces) + border
+        } else if (i == 5) {
+            line.append(NEXT_PICE_WIDTH, '-');
+            line.append('|');
+        } else if (i == 6) {
+            // Score display
+            line.append(" SCORE: ");
+            line.appendInt(engine.state.score, 6);
+            line.append('|');
+        } else if (i == 7) {
+            // Level display
+            line.append(" LEVEL: ");
+            line.appendInt(engine.state.level, 6);
+            line.append('|');
+        } else if (i == 8) {
+            // Lines cleared display
+            line.append(" LINES: ");
+            line.appendInt(engine.state.linesCleared, 6);
+            line.append('|');
+        } else if (i == 9 && engine.queue.depth > 1) {
+            line.append(NEXT_PICE_WIDTH, '-');
+            line.append('|');
+        } else if (i >= 10 && i <= 18 && i != 14) {
+            // The rest of the queue, two pieces side by side per 4-row band
+            int band = i < 14 ? 0 : 1;
+            int row = i - (band == 0 ? 10 : 15);
+            line.append("  ");
+            for (int k = 0; k < 2; ++k) {
+                appendQueuedPieceRow(line, engine, 1 + band * 2 + k, row);
+                line.append("  ");
+            }
+            line.append('|');
+        } else {
+            line.append(NEXT_PICE_WIDTH, ' ');
+            line.append('|');
+        }
+    }
+
+    // One 4-character row of the index-th queued piece (blank past the
+    // depth); index 0 is the next piece
+    static void appendQueuedPieceRow(TextFrame::Line& line, const Engine& engine, int index, int row) {
+        if (index >= engine.queue.depth) {
+            line.append(4, ' ');
+            return;
+        }
+        int type = engine.queue.peek(index);
+        for (int col = 0; col < 4; ++col) {
+            line.append(BlockTemplate::getCell(type, 0, row, col));
+        }
+    }
+};
+
+// Two frames next to each other, for versus play: each left row padded to
+// the widest left row plus gap spaces, then the right row. Built into out
+// like any other frame, so the renderer still sends only what changed.
+inline void joinFrames(const TextFrame& left, const TextFrame& right, int gap, TextFrame& out) {
+    size_t width = 0;
+    for (int i = 0; i < left.count; ++i) {
+        width = std::max(width, left.lines[i].size);
+    }
+
+    out.resize(std::max(left.count, right.count));
+    for (int i = 0; i < out.count; ++i) {
+        TextFrame::Line& line = out.lines[i];
+        line.clear();
+        size_t used = 0;
+        if (i < left.count) {
+            line.assign(left.lines[i]);
+            used = left.lines[i].size;
+        }
+        if (i < right.count) {
+            line.append(width - used + gap, ' ');
+            line.append(right.lines[i], 0, right.lines[i].size);
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#include "renderer.h"
+
+// Per-frame timing. The frontend adds the monotonic-clock time spent in each
+// phase of the game loop and closes a frame whenever it draws one; closed
+// frames go into a fixed ring of recent samples (for the p50/p99 HUD) and a
+// log2 histogram of the whole session (printed at exit).
+//
+// The ring is single-producer and lock-free: every field is an atomic and
+// the frame counter is published last, so any thread can read the recent
+// samples without stopping the game. The histogram and the frame being
+// measured belong to the game thread.
+
+enum FramePhase : uint8_t {
+    PHASE_INPUT,        // reading and handling keys
+    PHASE_GRAVITY,      // logic ticks and held-key repeats
+    PHASE_AI,           // autoplay search
+    PHASE_GHOST,        // ghost piece
+    PHASE_COMPOSE,      // layers, text rows and diff encoding
+    PHASE_WRITE,        // write() to the terminal
+    PHASE_LATE,         // sleeping past the loop's deadline
+    FRAME_PHASES,
+};
+
+struct FrameStats {
+    static constexpr int RING_SIZE = 1024;      // recent frames, power of two
+    static constexpr int BUCKETS = 22;          // < 1 us, then [2^(k-1), 2^k) us
+    static constexpr const char* PHASE_NAMES[FRAME_PHASES] = {
+        "input", "gravity", "ai", "ghost", "compose", "write", "late",
+    };
+
+    struct Sample {
+        std::atomic<uint32_t> ns[FRAME_PHASES];
+    };
+
+    struct Summary {
+        uint32_t p50[FRAME_PHASES]{};
+        uint32_t p99[FRAME_PHASES]{};
+        uint32_t max[FRAME_PHASES]{};
+        int frames{0};
+    };
+
+    Sample ring[RING_SIZE]{};
+    std::atomic<uint64_t> frames{0};
+
+    uint64_t histogram[FRAME_PHASES][BUCKETS]{};
+    int64_t current[FRAME_PHASES]{};    // frame being measured
+
+    void add(FramePhase phase, int64_t ns) {
+        if (ns > 0) current[phase] += ns;
+    }
+
+    // Closes the current frame and starts the next one
+    void endFrame() {
+        uint64_t n = frames.load(std::memory_order_relaxed);
+        Sample& sample = ring[n & (RING_SIZE - 1)];
+        for (int p = 0; p < FRAME_PHASES; ++p) {
+            uint32_t ns = static_cast<uint32_t>(std::min<int64_t>(current[p], UINT32_MAX));
+            sample.ns[p].store(ns, std::memory_order_relaxed);
+            ++histogram[p][bucket(ns)];
+            current[p] = 0;
+        }
+        frames.store(n + 1, std::memory_order_release);
+    }
+
+    static int bucket(uint32_t ns) {
+        uint32_t us = ns / 1000;
+        if (us == 0) return 0;
+        return std::min(BUCKETS - 1, 32 - __builtin_clz(us));
+    }
+
+    // Percentiles of the frames still in the ring. Sorting a thousand
+    // samples per phase is not free, so the HUD refreshes this now and then
+    // rather than every frame.
+    void summarize(Summary& out) const {
+        uint64_t end = frames.load(std::memory_order_acquire);
+        int count = static_cast<int>(std::min<uint64_t>(end, RING_SIZE));
+        out.frames = count;
+        if (count == 0) return;
+
+        uint32_t values[RING_SIZE];
+        for (int p = 0; p < FRAME_PHASES; ++p) {
+            for (int i = 0; i < count; ++i) {
+                values[i] = ring[(end - 1 - i) & (RING_SIZE - 1)].ns[p].load(std::memory_order_relaxed);
+            }
+            out.p50[p] = percentile(values, count, 50);
+            out.p99[p] = percentile(values, count, 99);
+            out.max[p] = *std::max_element(values, values + count);
+        }
+    }
+
+    static uint32_t percentile(uint32_t* values, int count, int p) {
+        int index = (count - 1) * p / 100;
+        std::nth_element(values, values + index, values + count);
+        return values[index];
+    }
+
+    // Two HUD lines below the frame: p50 and p99 per phase, in microseconds
+    static void appendHud(TextFrame& frame, const Summary& summary) {
+        if (frame.count + 2 > TextFrame::MAX_LINES) return;
+        const uint32_t* rows[2] = {summary.p50, summary.p99};
+        const char* labels[2] = {"p50 us ", "p99 us "};
+        for (int r = 0; r < 2; ++r) {
+            TextFrame::Line& line = frame.lines[frame.count++];
+            line.clear();
+            line.append(labels[r]);
+            for (int p = 0; p < FRAME_PHASES; ++p) {
+                line.append(' ');
+                line.append(PHASE_NAMES[p]);
+                line.append(' ');
+                appendMicros(line, rows[r][p]);
+            }
+        }
+    }
+
+    // ns as microseconds with one decimal
+    static void appendMicros(TextFrame::Line& line, uint32_t ns) {
+        uint32_t tenths = (ns + 50) / 100;
+        line.appendInt(tenths / 10);
+        line.append('.');
+        line.append(static_cast<char>('0' + tenths % 10));
+    }
+
+    // Session histogram, one column per phase, plus the recent percentiles
+    void print(FILE* out) const {
+        uint64_t total = frames.load(std::memory_order_acquire);
+        fprintf(out, "frame timing: %llu frames\n", static_cast<unsigned long long>(total));
+        if (total == 0) return;
+
+        int first = BUCKETS, last = -1;
+        for (int p = 0; p < FRAME_PHASES; ++p) {
+            for (int b = 0; b < BUCKETS; ++b) {
+                if (histogram[p][b] == 0) continue;
+                first = std::min(first, b);
+                last = std::max(last, b);
+            }
+        }
+
+        fprintf(out, "%-16s", "us");
+        for (const char* name : PHASE_NAMES) fprintf(out, "%10s", name);
+        fprintf(out, "\n");
+
+        for (int b = first; b <= last; ++b) {
+            char label[32];
+            if (b == 0) {
+                snprintf(label, sizeof(label), "< 1");
+            } else if (b == BUCKETS - 1) {
+                snprintf(label, sizeof(label), ">= %u", 1u << (b - 1));
+            } else {
+                snprintf(label, sizeof(label), "%u - %u", 1u << (b - 1), 1u << b);
+            }
+            fprintf(out, "%-16s", label);
+            for (int p = 0; p < FRAME_PHASES; ++p) {
+                fprintf(out, "%10llu", static_cast<unsigned long long>(histogram[p][b]));
+            }
+            fprintf(out, "\n");
+        }
+
+        Summary summary;
+        summarize(summary);
+        const uint32_t* rows[3] = {summary.p50, summary.p99, summary.max};
+        const char* labels[3] = {"p50", "p99", "max"};
+        for (int r = 0; r < 3; ++r) {
+            char label[32];
+            snprintf(label, sizeof(label), "%s (last %d)", labels[r], summary.frames);
+            fprintf(out, "%-16s", label);
+            for (int p = 0; p < FRAME_PHASES; ++p) {
+                fprintf(out, "%10.1f", rows[r][p] / 1000.0);
+            }
+            fprintf(out, "\n");
+        }
+    }
+};
@@ -0,0 +1,485 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Terminal input decoding. Everything the terminal has sent is pulled into
+// a byte ring with a single readv() per wakeup, then a state machine turns
+// it into timestamped key events: plain and UTF-8 characters, control keys,
+// ESC-prefixed Alt keys, CSI and SS3 sequences (arrows, Home/End, editing
+// keys, F1-F12 and keypad, with xterm modifier parameters), focus reports
+// and bracketed-paste markers. Terminals that speak the kitty keyboard
+// protocol additionally report CSI u keys with press/repeat/release event
+// types. Unknown sequences are consumed whole, so their bytes never leak
+// out as stray characters.
+
+enum class Key : uint8_t {
+    None,
+    Char,           // printable character, see KeyEvent::codepoint
+    Enter,
+    Tab,
+    Backspace,
+    Escape,
+    Up,
+    Down,
+    Left,
+    Right,
+    Home,
+    End,
+    Insert,
+    Delete,
+    PageUp,
+    PageDown,
+    F1, F2, F3, F4, F5, F6, F7, F8, F9, F10, F11, F12,
+    FocusIn,
+    FocusOut,
+    PasteStart,
+    PasteEnd,
+    KeyboardFlags,  // reply to a kitty protocol query, flags in codepoint
+    Unknown,        // well-formed sequence we do not map
+};
+
+enum KeyMod : uint8_t {
+    MOD_SHIFT = 1,
+    MOD_ALT   = 2,
+    MOD_CTRL  = 4,
+    MOD_META  = 8,
+};
+
+// Only the kitty keyboard protocol reports Repeat and Release; legacy
+// terminals send every auto-repeated key as another Press
+enum class KeyAction : uint8_t {
+    Press,
+    Repeat,
+    Release,
+};
+
+struct KeyEvent {
+    Key key{Key::None};
+    uint32_t codepoint{0};  // for Key::Char
+    uint8_t mods{0};        // KeyMod bits
+    KeyAction action{KeyAction::Press};
+    bool pasted{false};     // arrived inside a bracketed paste
+    int64_t timeNs{0};      // CLOCK_MONOTONIC time the bytes were read
+};
+
+struct InputDecoder {
+    static constexpr size_t RING_SIZE = 4096;    // power of two
+    static constexpr size_t QUEUE_SIZE = 256;    // power of two
+    static constexpr size_t MAX_PARAMS = 8;
+
+    // A lone ESC is only reported once no sequence byte followed it
+    // within this time
+    static constexpr int64_t ESC_TIMEOUT_NS = 25000000;
+
+    enum class State : uint8_t { Ground, Escape, Csi, Ss3, Utf8 };
+
+    // Raw bytes, filled by readv() and drained by parse()
+    uint8_t ring[RING_SIZE]{};
+    size_t ringHead{0};     // next byte to parse
+    size_t ringTail{0};     // next byte to fill
+
+    // Decoded events waiting for the game
+    KeyEvent queue[QUEUE_SIZE]{};
+    size_t queueHead{0};
+    size_t queueTail{0};
+    size_t dropped{0};      // events lost to a full queue
+
+    // Parser state, kept across reads so split sequences still decode
+    State state{State::Ground};
+    int params[MAX_PARAMS]{};
+    int subParams[MAX_PARAMS]{};    // first ':' sub-parameter of each param
+    size_t paramCount{0};
+    size_t subCount{0};             // ':' seen in the current parameter
+    uint8_t privateMarker{0};   // '<', '=', '>' or '?' right after CSI
+    uint32_t utf8Codepoint{0};
+    int utf8Remaining{0};
+    bool inPaste{false};
+    int64_t escapeSinceNs{0};
+
+    // Read everything currently available from fd with one syscall and
+    // decode it. Returns false once the fd reports end of file.
+    bool fill(int fd, int64_t nowNs) {
+        size_t used = ringTail - ringHead;
+        size_t space = RING_SIZE - used;
+        if (space == 0) {
+            parse(nowNs);
+            return true;
+        }
+
+        // The free region may wrap around the end of the ring
+        size_t tail = ringTail & (RING_SIZE - 1);
+        size_t first = RING_SIZE - tail < space ? RING_SIZE - tail : space;
+        iovec iov[2];
+        iov[0].iov_base = ring + tail;
+        iov[0].iov_len = first;
+        iov[1].iov_base = ring;
+        iov[1].iov_len = space - first;
+
+        ssize_t n = readv(fd, iov, iov[1].iov_len ? 2 : 1);
+        if (n > 0) {
+            ringTail += static_cast<size_t>(n);
+        }
+        parse(nowNs);
+        return n != 0;
+    }
+
+    // Feed bytes directly (tests, replays, sockets that were read elsewhere)
+    void feed(const uint8_t* data, size_t len, int64_t nowNs) {
+        while (len > 0) {
+            size_t space = RING_SIZE - (ringTail - ringHead);
+            size_t chunk = len < space ? len : space;
+            for (size_t i = 0; i < chunk; ++i) {
+                ring[(ringTail + i) & (RING_SIZE - 1)] = data[i];
+            }
+            ringTail += chunk;
+            data += chunk;
+            len -= chunk;
+            parse(nowNs);
+        }
+    }
+
+    bool next(KeyEvent& event) {
+        if (queueHead == queueTail) return false;
+        event = queue[queueHead & (QUEUE_SIZE - 1)];
+        ++queueHead;
+        return true;
+    }
+
+    bool hasEvents() const {
+        return queueHead != queueTail;
+    }
+
+    // Deadline by which expire() must run to resolve a pending lone ESC,
+    // or -1 when nothing is pending
+    int64_t pendingDeadline() const {
+        return state == State::Escape ? escapeSinceNs + ESC_TIMEOUT_NS : -1;
+    }
+
+    // Turn a lone ESC that was not followed by a sequence into a key
+    void expire(int64_t nowNs) {
+        if (state == State::Escape && nowNs - escapeSinceNs >= ESC_TIMEOUT_NS) {
+            state = State::Ground;
+            push(Key::Escape, 0, 0, escapeSinceNs);
+        }
+    }
+
+    // Forget buffered bytes, partial sequences and queued events
+    void clear() {
+        ringHead = ringTail = 0;
+        queueHead = queueTail = 0;
+        state = State::Ground;
+        inPaste = false;
+    }
+
+    // ---------- state machine ----------
+
+    void parse(int64_t nowNs) {
+        while (ringHead != ringTail) {
+            uint8_t byte = ring[ringHead & (RING_SIZE - 1)];
+            ++ringHead;
+            consume(byte, nowNs);
+        }
+    }
+
+    void consume(uint8_t byte, int64_t nowNs) {
+        switch (state) {
+            case State::Ground:
+                ground(byte, nowNs);
+                break;
+
+            case State::Escape:
+                if (byte == '[') {
+                    startSequence(State::Csi);
+                } else if (byte == 'O') {
+                    startSequence(State::Ss3);
+                } else if (byte == 0x1b) {
+                    // ESC ESC: the first one was a real Escape key
+                    push(Key::Escape, 0, 0, escapeSinceNs);
+                    escapeSinceNs = nowNs;
+                } else {
+                    // ESC + key is how terminals send Alt+key
+                    size_t before = queueTail;
+                    state = State::Ground;
+                    ground(byte, nowNs);
+                    if (queueTail != before) {
+                        queue[(queueTail - 1) & (QUEUE_SIZE - 1)].mods |= MOD_ALT;
+                    }
+                }
+                break;
+
+            case State::Csi:
+                csi(byte, nowNs);
+                break;
+
+            case State::Ss3:
+                state = State::Ground;
+                ss3(byte, nowNs);
+                break;
+
+            case State::Utf8:
+                if ((byte & 0xC0) != 0x80) {
+                    // Broken sequence: drop it and reparse this byte
+                    state = State::Ground;
+                    ground(byte, nowNs);
+                    break;
+                }
+                utf8Codepoint = (utf8Codepoint << 6) | (byte & 0x3F);
+                if (--utf8Remaining == 0) {
+                    state = State::Ground;
+                    push(Key::Char, utf8Codepoint, 0, nowNs);
+                }
+                break;
+        }
+    }
+
+    void ground(uint8_t byte, int64_t nowNs) {
+        if (byte == 0x1b) {
+            state = State::Escape;
+            escapeSinceNs = nowNs;
+        } else if (byte == '\r' || byte == '\n') {
+            push(Key::Enter, 0, 0, nowNs);
+        } else if (byte == '\t') {
+            push(Key::Tab, 0, 0, nowNs);
+        } else if (byte == 0x7f || byte == 0x08) {
+            push(Key::Backspace, 0, 0, nowNs);
+        } else if (byte < 0x20) {
+            // Ctrl+A .. Ctrl+Z and friends
+            push(Key::Char, static_cast<uint32_t>(byte) + 0x60, MOD_CTRL, nowNs);
+        } else if (byte < 0x80) {
+            push(Key::Char, byte, 0, nowNs);
+        } else if ((byte & 0xE0) == 0xC0) {
+            beginUtf8(byte & 0x1F, 1);
+        } else if ((byte & 0xF0) == 0xE0) {
+            beginUtf8(byte & 0x0F, 2);
+        } else if ((byte & 0xF8) == 0xF0) {
+            beginUtf8(byte & 0x07, 3);
+        }
+        // Stray continuation bytes are dropped
+    }
+
+    void beginUtf8(uint32_t bits, int remaining) {
+        state = State::Utf8;
+        utf8Codepoint = bits;
+        utf8Remaining = remaining;
+    }
+
+    void startSequence(State next) {
+        state = next;
+        paramCount = 0;
+        subCount = 0;
+        privateMarker = 0;
+        for (int& p : params) p = 0;
+        for (int& p : subParams) p = 0;
+    }
+
+    void csi(uint8_t byte, int64_t nowNs) {
+        if (byte >= '0' && byte <= '9') {
+            if (paramCount == 0) paramCount = 1;
+            // Only the first sub-parameter is kept (the kitty event type)
+            if (subCount > 1) return;
+            int& p = subCount == 0 ? params[paramCount - 1] : subParams[paramCount - 1];
+            if (p < 100000) p = p * 10 + (byte - '0');
+        } else if (byte == ';') {
+            if (paramCount == 0) paramCount = 1;
+            if (paramCount < MAX_PARAMS) ++paramCount;
+            subCount = 0;
+        } else if (byte == ':') {
+            if (paramCount == 0) paramCount = 1;
+            ++subCount;
+        } else if (byte >= '<' && byte <= '?') {
+            privateMarker = byte;
+        } else if (byte >= 0x20 && byte <= 0x2F) {
+            // Intermediate bytes: no key we decode uses them
+        } else if (byte >= 0x40 && byte <= 0x7E) {
+            state = State::Ground;
+            finishCsi(byte, nowNs);
+        } else {
+            // Control byte inside a sequence: abandon it
+            state = State::Ground;
+            ground(byte, nowNs);
+        }
+    }
+
+    // xterm encodes modifiers as 1 + bitmask in the second parameter
+    uint8_t modifiers(size_t index) const {
+        if (index >= paramCount || params[index] <= 1) return 0;
+        return static_cast<uint8_t>((params[index] - 1) & 0x0F);
+    }
+
+    // kitty protocol: event type as a sub-parameter of the modifiers
+    KeyAction keyAction(size_t index) const {
+        if (index >= paramCount) return KeyAction::Press;
+        switch (subParams[index]) {
+            case 2: return KeyAction::Repeat;
+            case 3: return KeyAction::Release;
+            default: return KeyAction::Press;
+        }
+    }
+
+    void finishCsi(uint8_t final, int64_t nowNs) {
+        if (privateMarker == '?' && final == 'u') {
+            // CSI ? flags u: the terminal supports the kitty protocol
+            push(Key::KeyboardFlags, paramCount > 0 ? params[0] : 0, 0, nowNs);
+            return;
+        }
+        if (privateMarker != 0) {
+            push(Key::Unknown, final, 0, nowNs);
+            return;
+        }
+
+        uint8_t mods = modifiers(1);
+        KeyAction action = keyAction(1);
+        switch (final) {
+            case 'A': push(Key::Up, 0, mods, nowNs, action); return;
+            case 'B': push(Key::Down, 0, mods, nowNs, action); return;
+            case 'C': push(Key::Right, 0, mods, nowNs, action); return;
+            case 'D': push(Key::Left, 0, mods, nowNs, action); return;
+            case 'H': push(Key::Home, 0, mods, nowNs, action); return;
+            case 'F': push(Key::End, 0, mods, nowNs, action); return;
+            case 'P': push(Key::F1, 0, mods, nowNs, action); return;
+            case 'Q': push(Key::F2, 0, mods, nowNs, action); return;
+            case 'R': push(Key::F3, 0, mods, nowNs, action); return;
+            case 'S': push(Key::F4, 0, mods, nowNs, action); return;
+            case 'Z': push(Key::Tab, 0, MOD_SHIFT, nowNs); return;
+            case 'I': push(Key::FocusIn, 0, 0, nowNs); return;
+            case 'O': push(Key::FocusOut, 0, 0, nowNs); return;
+            case '~': tilde(nowNs); return;
+            case 'u': kittyKey(nowNs); return;
+            default: push(Key::Unknown, final, 0, nowNs); return;
+        }
+    }
+
+    // CSI <number> ; <modifiers> ~ (vt220 style editing and function keys)
+    void tilde(int64_t nowNs) {
+        uint8_t mods = modifiers(1);
+        Key key = Key::Unknown;
+        switch (paramCount > 0 ? params[0] : 0) {
+            case 1: case 7: key = Key::Home; break;
+            case 2: key = Key::Insert; break;
+            case 3: key = Key::Delete; break;
+            case 4: case 8: key = Key::End; break;
+            case 5: key = Key::PageUp; break;
+            case 6: key = Key::PageDown; break;
+            case 11: key = Key::F1; break;
+            case 12: key = Key::F2; break;
+            case 13: key = Key::F3; break;
+            case 14: key = Key::F4; break;
+            case 15: key = Key::F5; break;
+            case 17: key = Key::F6; break;
+            case 18: key = Key::F7; break;
+            case 19: key = Key::F8; break;
+            case 20: key = Key::F9; break;
+            case 21: key = Key::F10; break;
+            case 23: key = Key::F11; break;
+            case 24: key = Key::F12; break;
+            case 200:
+                push(Key::PasteStart, 0, 0, nowNs);
+                inPaste = true;
+                return;
+            case 201:
+                inPaste = false;
+                push(Key::PasteEnd, 0, 0, nowNs);
+                return;
+        }
+        push(key, 0, mods, nowNs, keyAction(1));
+    }
+
+    // CSI code ; modifiers:event u (kitty keyboard protocol). The code is
+    // the unshifted key, so Shift+letter is turned back into upper case.
+    void kittyKey(int64_t nowNs) {
+        uint32_t code = paramCount > 0 ? static_cast<uint32_t>(params[0]) : 0;
+        uint8_t mods = modifiers(1);
+        KeyAction action = keyAction(1);
+        switch (code) {
+            case 9: push(Key::Tab, 0, mods, nowNs, action); return;
+            case 13: push(Key::Enter, 0, mods, nowNs, action); return;
+            case 27: push(Key::Escape, 0, mods, nowNs, action); return;
+            case 127: push(Key::Backspace, 0, mods, nowNs, action); return;
+        }
+
+        // 57344 and up are the protocol's private-use functional keys
+        // (keypad, media, lone modifiers), which nothing here binds
+        if (code < 0x20 || (code >= 57344 && code <= 63743)) {
+            push(Key::Unknown, 'u', mods, nowNs, action);
+            return;
+        }
+        if ((mods & MOD_SHIFT) && code >= 'a' && code <= 'z') {
+            code -= 'a' - 'A';
+            mods &= ~MOD_SHIFT;
+        }
+        push(Key::Char, code, mods, nowNs, action);
+    }
+
+    // SS3 <final>: application cursor keys, F1-F4 and the keypad
+    void ss3(uint8_t final, int64_t nowNs) {
+        switch (final) {
+            case 'A': push(Key::Up, 0, 0, nowNs); return;
+            case 'B': push(Key::Down, 0, 0, nowNs); return;
+            case 'C': push(Key::Right, 0, 0, nowNs); return;
+            case 'D': push(Key::Left, 0, 0, nowNs); return;
+            case 'H': push(Key::Home, 0, 0, nowNs); return;
+            case 'F': push(Key::End, 0, 0, nowNs); return;
+            case 'P': push(Key::F1, 0, 0, nowNs); return;
+            case 'Q': push(Key::F2, 0, 0, nowNs); return;
+            case 'R': push(Key::F3, 0, 0, nowNs); return;
+            case 'S': push(Key::F4, 0, 0, nowNs); return;
+            case 'M': push(Key::Enter, 0, 0, nowNs); return;
+            case 'X': push(Key::Char, '=', 0, nowNs); return;
+        }
+
+        // Keypad in application mode: ESC O j..y = * + , - . / 0..9
+        if (final >= 'j' && final <= 'y') {
+            push(Key::Char, static_cast<uint32_t>(final - 'j' + '*'), 0, nowNs);
+            return;
+        }
+        push(Key::Unknown, final, 0, nowNs);
+    }
+
+    void push(Key key, uint32_t codepoint, uint8_t mods, int64_t nowNs,
+              KeyAction action = KeyAction::Press) {
+        if (queueTail - queueHead == QUEUE_SIZE) {
+            ++dropped;
+            return;
+        }
+        KeyEvent& event = queue[queueTail & (QUEUE_SIZE - 1)];
+        event.key = key;
+        event.codepoint = codepoint;
+        event.mods = mods;
+        event.action = action;
+        event.pasted = inPaste && key != Key::PasteStart && key != Key::PasteEnd;
+        event.timeNs = nowNs;
+        ++queueTail;
+    }
+};
+
+// Map a decoded key to the game's command characters
+inline char commandForKey(const KeyEvent& event) {
+    // Pasted text is not typing
+    if (event.pasted) return 0;
+
+    // With the kitty protocol Ctrl+C arrives as a key, not as SIGINT
+    if (event.key == Key::Char && event.codepoint == 'c' && (event.mods & MOD_CTRL)) {
+        return 'q';
+    }
+
+    switch (event.key) {
+        case Key::Up: return 'w';    // Up arrow -> rotate
+        case Key::Down: return 's';  // Down arrow -> soft drop
+        case Key::Right: return 'd'; // Right arrow -> move right
+        case Key::Left: return 'a';  // Left arrow -> move left
+        case Key::Enter: return '\n';
+        case Key::Escape: return 27;
+        case Key::Char:
+            if (event.codepoint < 0x80 && !(event.mods & (MOD_CTRL | MOD_ALT))) {
+                // Commands are lowercase letters, so Caps Lock changes nothing
+                char c = static_cast<char>(event.codepoint);
+                return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
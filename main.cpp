@@ -1,6 +1,7 @@
 #include <iostream>
-#include <fstream>
+#include <string>
 #include <vector>
+#include <memory>
 #include <algorithm>
 #include <cstdlib>
 #include <ctime>
@@ -9,297 +10,183 @@
 #include <fcntl.h>
 #include <random>
 
+#include "auto_repeat.h"
+#include "autoplay.h"
+#include "compositor.h"
+#include "engine.h"
+#include "event_loop.h"
+#include "frame.h"
+#include "frame_stats.h"
+#include "input.h"
+#include "renderer.h"
+#include "replay.h"
+#include "score_store.h"
+#include "snapshot.h"
+
 using namespace std;
 
-constexpr int BOARD_HEIGHT     = 20;
-constexpr int BOARD_WIDTH      = 15;
-constexpr int NEXT_PICE_WIDTH  = 14;
+// frontend timing
+constexpr int     RENDER_HZ          = 60;        // max redraws per second
+constexpr int64_t STATS_REFRESH_NS   = 500000000; // timing HUD update interval
+constexpr int     AUTOPLAY_INPUT_HZ  = 15;        // demo inputs per second
+constexpr int     VERSUS_GAP         = 4;         // spaces between the two boards
+constexpr int64_t NOTICE_NS          = 2000000000; // how long a notice line shows
+
+// kitty keyboard protocol flags we ask for: disambiguate escape codes (1),
+// report event types (2) and report all keys as escape codes (8), so even
+// plain letters come with press/repeat/release
+constexpr int KITTY_KEYBOARD_FLAGS = 1 | 2 | 8;
+
+// Shared high score table; scores from the old text file are carried over
+constexpr const char* HIGH_SCORE_FILE = "high_scores.dat";
+constexpr const char* LEGACY_HIGH_SCORE_FILE = "high_scores.txt";
+
+// Where S saves the game unless --snapshot or --resume names a file
+constexpr const char* SNAPSHOT_FILE = "tetris.snap";
+
+struct FrontendOptions {
+    int dasMs{167};
+    int arrMs{33};
+    int softDropArrMs{33};
+    bool kittyKeyboard{true};   // use the kitty protocol when supported
+    string recordPath;          // save each game's replay here
+    string replayPath;          // play this recording instead of a game
+    bool headless{false};       // replay at full speed without a terminal
+    bool fixedSeed{false};      // --seed given: the game sequence repeats
+    uint32_t seed{0};
+    Randomizer randomizer{Randomizer::Bag7};
+    int previewDepth{5};        // queued pieces, the side panel shows up to 5
+    bool autoplay{false};       // the built-in AI plays
+    int searchThreads{0};       // AI search threads, 0 = one per hardware thread
+    int beamWidth{AutoPlayer::DEFAULT_BEAM};
+    int maxPieces{1000};        // headless autoplay stops here
+    bool frameStats{false};     // timing HUD on, histogram at exit
+    string playerName;          // high score table entry, defaults to $USER
+    int boardWidth{DEFAULT_BOARD_WIDTH};    // one of the sizes runGame() instantiates
+    int boardHeight{DEFAULT_BOARD_HEIGHT};
+    bool versus{false};         // a second board next to the first
+    bool versusAi{false};       // the AI plays it, else player 2 on the arrows
+    string snapshotPath;        // V saves the game here
+    string resumePath;          // the first game carries on from this snapshot
+};
 
-constexpr int BLOCK_SIZE       = 4;
-constexpr int NUM_BLOCK_TYPES  = 7;
+template <int Width, int Height>
+unique_ptr<BasicAutoPlayer<Width, Height>> makeAutoPlayer(const FrontendOptions& options) {
+    auto bot = make_unique<BasicAutoPlayer<Width, Height>>(options.searchThreads);
+    bot->beamWidth = options.beamWidth;
+    bot->lookahead = options.previewDepth;
+    return bot;
+}
+
+// Terminal frontend: input, timing, rendering and high scores on top of
+// the headless Engine, which owns all game rules.
+template <int Width, int Height>
+struct TetrisGame {
+    using Engine = BasicEngine<Width, Height>;
+    using AutoPlayer = BasicAutoPlayer<Width, Height>;
 
-// gameplay tuning
-constexpr long BASE_DROP_SPEED_US   = 500000; // base drop speed (µs)
-constexpr int  DROP_INTERVAL_TICKS  = 5;      // logic steps per drop
+    // Start, pause and game over screens; wide enough for their text on
+    // boards narrower than the default
+    static constexpr int SCREEN_WIDTH = max(Width, DEFAULT_BOARD_WIDTH) + NEXT_PICE_WIDTH + 2;
 
-struct Position {
-    int x{}, y{};
-    Position() = default;
-    Position(int _x, int _y) : x(_x), y(_y) {}
-};
+    Engine engine;
 
-struct GameState {
-    bool running{true};
     bool paused{false};
     bool ghostEnabled{true};  // Ghost shadow enabled by default
+    bool statsVisible{false}; // frame timing HUD below the board
     bool quitByUser{false};   // Track if user quit manually vs. game over
-    int score{0};
-    int level{1};
-    int linesCleared{0};
-};
 
-struct Piece {
-    int type{0};
-    int rotation{0};
-    Position pos{5, 0};
-};
-
-struct Board {
-    char grid[BOARD_HEIGHT][BOARD_WIDTH]{};
-
-    void init() {
-        // Initialize entire grid as empty spaces
-        // Borders will be drawn separately in draw() function
-        for (int i = 0; i < BOARD_HEIGHT; ++i) {
-            for (int j = 0; j < BOARD_WIDTH; ++j) {
-                grid[i][j] = ' ';
-            }
-        }
-    }
+    TerminalRenderer renderer;
+    Compositor<Width, Height> compositor;
+    FrameBuilder<Width, Height> frame;  // text rows of the last assembled frame
+    FrameStats stats;           // where each frame's time went
+    FrameStats::Summary statsShown;
+    int64_t statsShownNs{0};
+    EventLoop events;
+    InputDecoder input;
 
-    void draw(const GameState& state, const string nextPieceLines[4]) const {
-        // Build entire frame in a string buffer for single output
-        string frame;
-        frame.reserve(3072); // Pre-allocate to avoid reallocation
-
-        // Clear screen + move cursor to top-left
-        frame += "\033[2J\033[1;1H";
-        const string title = "TETRIS GAME";
-
-        // Top border (simple ASCII)
-        frame += '+';
-        frame.append(BOARD_WIDTH, '-');
-        frame += '+';
-        frame.append(NEXT_PICE_WIDTH, '-');
-        frame += "+\n";
-
-        // Title row
-        frame += '|';
-        int totalPadding = BOARD_WIDTH - title.size();
-        int leftPad = totalPadding / 2;
-        int rightPad = totalPadding - leftPad;
-
-        frame.append(leftPad, ' ');
-        frame += title;
-        frame.append(rightPad, ' ');
-        frame += "|  NEXT PIECE  |\n";
-
-        // Divider
-        frame += '+';
-        frame.append(BOARD_WIDTH, '-');
-        frame += '+';
-        frame.append(NEXT_PICE_WIDTH, '-');
-        frame += "+\n";
-
-        // Draw board rows with borders
-        for (int i = 0; i < BOARD_HEIGHT; ++i) {
-            // Left border
-            frame += '|';
-
-            // Draw board cells
-            for (int j = 0; j < BOARD_WIDTH; ++j) {
-                frame += grid[i][j];
-            }
-
-            // Right border
-            frame += '|';
-
-            // Draw right side panel with next piece preview and stats
-            if (i == 0) {
-                frame += "              |";
-            } else if (i >= 1 && i <= 4) {
-                // Draw next piece preview line
-                frame += "     ";  // Left padding (5 spaces)
-                frame += nextPieceLines[i - 1];  // 4 chars for the piece
-                frame += "     |";  // Right padding (5 spaces) + border
-            } else if (i == 5) {
-                frame.append(NEXT_PICE_WIDTH, '-');
-                frame += '|';
-            } else if (i == 6) {
-                // Score display
-                char buf[20];
-                snprintf(buf, sizeof(buf), " SCORE: %-6d", state.score);
-                frame += buf;
-                frame += '|';
-            } else if (i == 7) {
-                // Level display
-                char buf[20];
-                snprintf(buf, sizeof(buf), " LEVEL: %-6d", state.level);
-                frame += buf;
-                frame += '|';
-            } else if (i == 8) {
-                // Lines cleared display
-                char buf[20];
-                snprintf(buf, sizeof(buf), " LINES: %-6d", state.linesCleared);
-                frame += buf;
-                frame += '|';
-            } else {
-                frame.append(NEXT_PICE_WIDTH, ' ');
-                frame += '|';
-            }
-
-            frame += '\n';
-        }
-
-        // Bottom border
-        frame += '+';
-        frame.append(BOARD_WIDTH, '-');
-        frame += '+';
-        frame.append(NEXT_PICE_WIDTH, '-');
-        frame += "+\n";
-
-        frame += "Controls: ←→ or A/D (Move)  ↑/W (Rotate)  ↓/S (Soft Drop)  SPACE (Hard Drop)  G (Ghost)  P (Pause)  Q (Quit)\n";
-
-        // Single output call
-        cout << frame;
-        cout.flush();
-    }
-
-    int clearLines() {
-        int writeRow = BOARD_HEIGHT - 1;
-        int linesCleared = 0;
+    termios origTermios{};
+    bool rawMode{false};
+
+    FrontendOptions options;
+    AutoRepeat repeat;
+    bool kittyKeyboard{false};  // terminal accepted the kitty protocol
+
+    // Ghost piece, recomputed only when the piece or the board changed
+    Piece ghost{};
+    Piece ghostFor{};
+    uint32_t ghostRevision{0};
+    bool ghostValid{false};
+
+    // Every engine call is recorded so the game can be replayed exactly
+    mt19937 seeder;             // one fresh engine seed per game
+    Replay recording;
+    uint32_t ticks{0};          // engine ticks in the current game
+    bool recordSaved{true};
+
+    // --autoplay: the AI's inputs replace the keyboard (attract mode)
+    unique_ptr<AutoPlayer> bot;
+
+    // --versus: a second board on the same clock and the same pieces,
+    // played by the arrow keys or the AI; line clears send garbage across
+    bool versus{false};
+    Engine rival;
+    Compositor<Width, Height> rivalCompositor;
+    FrameBuilder<Width, Height> rivalFrame;
+    TextFrame versusRows;       // both boards side by side
+    unique_ptr<AutoPlayer> rivalBot;
+
+    bool resumed{false};        // the engine holds a snapshot, not a new game
+    string notice;              // one line below the board, e.g. "snapshot saved"
+    string scoreNote;           // game over screen: trouble with the high score file
+    int64_t noticeUntilNs{0};
+
+    explicit TetrisGame(const FrontendOptions& opts) : options(opts) {
+        statsVisible = options.frameStats;
+        random_device rd;
+        seeder.seed(options.fixedSeed ? options.seed : rd());
+        engine.configure(options.randomizer, options.previewDepth);
 
-        // Scan from bottom to top
-        for (int readRow = BOARD_HEIGHT - 1; readRow >= 0; --readRow) {
-            bool full = true;
-            for (int j = 0; j < BOARD_WIDTH; ++j) {
-                if (grid[readRow][j] == ' ') {
-                    full = false;
-                    break;
-                }
-            }
+        const int64_t MS = 1000000;
+        repeat.timing[REPEAT_LEFT] = {options.dasMs * MS, options.arrMs * MS};
+        repeat.timing[REPEAT_RIGHT] = {options.dasMs * MS, options.arrMs * MS};
+        repeat.timing[REPEAT_DOWN] = {0, options.softDropArrMs * MS};
 
-            // Keep non-full rows, skip full ones
-            if (!full) {
-                if (writeRow != readRow) {
-                    for (int j = 0; j < BOARD_WIDTH; ++j) {
-                        grid[writeRow][j] = grid[readRow][j];
-                    }
-                }
-                --writeRow;
-            } else {
-                ++linesCleared;
-            }
+        if (options.autoplay) {
+            bot = makeAutoPlayer<Width, Height>(options);
         }
-
-        // Clear remaining top rows
-        while (writeRow >= 0) {
-            for (int j = 0; j < BOARD_WIDTH; ++j) {
-                grid[writeRow][j] = ' ';
-            }
-            --writeRow;
+        if (options.versus) {
+            versus = true;
+            rival.configure(options.randomizer, options.previewDepth);
+            if (options.versusAi) rivalBot = makeAutoPlayer<Width, Height>(options);
         }
-
-        return linesCleared;
     }
-};
-
-struct BlockTemplate {
-    static char templates[NUM_BLOCK_TYPES][BLOCK_SIZE][BLOCK_SIZE];
-
-    static void setBlockTemplate(int type,
-                                 char symbol,
-                                 const int shape[BLOCK_SIZE][BLOCK_SIZE]) {
-        for (int i = 0; i < BLOCK_SIZE; ++i) {
-            for (int j = 0; j < BLOCK_SIZE; ++j) {
-                templates[type][i][j] = shape[i][j] ? symbol : ' ';
-            }
-        }
-    }
-
-    static void initializeTemplates() {
-        static const int TETROMINOES[7][4][4] = {
-            // I
-            {
-                {0,1,0,0},
-                {0,1,0,0},
-                {0,1,0,0},
-                {0,1,0,0}
-            },
-            // O
-            {
-                {0,0,0,0},
-                {0,1,1,0},
-                {0,1,1,0},
-                {0,0,0,0}
-            },
-            // T
-            {
-                {0,0,0,0},
-                {0,1,0,0},
-                {1,1,1,0},
-                {0,0,0,0}
-            },
-            // S
-            {
-                {0,0,0,0},
-                {0,1,1,0},
-                {1,1,0,0},
-                {0,0,0,0}
-            },
-            // Z
-            {
-                {0,0,0,0},
-                {1,1,0,0},
-                {0,1,1,0},
-                {0,0,0,0}
-            },
-            // J
-            {
-                {0,0,0,0},
-                {1,0,0,0},
-                {1,1,1,0},
-                {0,0,0,0}
-            },
-            // L
-            {
-                {0,0,0,0},
-                {0,0,1,0},
-                {1,1,1,0},
-                {0,0,0,0}
-            }
-        };
 
-        static const char NAMES[7] = {'I','O','T','S','Z','J','L'};
-
-        for (int i = 0; i < 7; i++) {
-            setBlockTemplate(i, NAMES[i], TETROMINOES[i]);
+    // Assemble the text frame from a composed playfield and draw it; this
+    // closes a frame for the timing stats
+    void drawBoard(const Playfield<Width, Height>& field) {
+        int64_t start = monotonicNowNs();
+        if (statsVisible && start - statsShownNs >= STATS_REFRESH_NS) {
+            stats.summarize(statsShown);
+            statsShownNs = start;
+            start = monotonicNowNs();
         }
-    }
 
-    // rotation: 0-3 (90° steps clockwise)
-    static char getCell(int type, int rotation, int row, int col) {
-        int r = row;
-        int c = col;
-
-        for (int i = 0; i < rotation; ++i) {
-            int temp = 3 - c;
-            c = r;
-            r = temp;
+        frame.assemble(field, engine);
+        TextFrame& rows = versus ? assembleVersus() : frame.rows;
+        if (start < noticeUntilNs && rows.count < TextFrame::MAX_LINES) {
+            TextFrame::Line& line = rows.lines[rows.count++];
+            line.clear();
+            line.append(notice.c_str());
         }
-
-        return templates[type][r][c];
-    }
-};
-
-char BlockTemplate::templates[NUM_BLOCK_TYPES][BLOCK_SIZE][BLOCK_SIZE];
-
-struct TetrisGame {
-    Board board;
-    GameState state;
-    Piece currentPiece{};
-    int nextPieceType{0};  // Store the type of next piece to display
-
-    termios origTermios{};
-    long dropSpeedUs{BASE_DROP_SPEED_US};
-    int dropCounter{0};
-    bool softDropActive{false};  // Track if 's' key is being held for soft drop
-
-    mt19937 rng;
-
-    TetrisGame() {
-        random_device rd;
-        rng.seed(rd());
+        if (statsVisible) FrameStats::appendHud(rows, statsShown);
+        renderer.encode(rows);
+        int64_t encoded = monotonicNowNs();
+        renderer.flush();
+
+        stats.add(PHASE_COMPOSE, encoded - start);
+        stats.add(PHASE_WRITE, monotonicNowNs() - encoded);
+        stats.endFrame();
     }
 
     void drawStartScreen() {
@@ -311,7 +198,7 @@ struct TetrisGame {
         screen += "\033[2J\033[1;1H";
 
         // Calculate width for start screen (match board display width)
-        int totalWidth = BOARD_WIDTH + NEXT_PICE_WIDTH + 2; // +2 for borders
+        int totalWidth = SCREEN_WIDTH;
 
         // Top border (ASCII)
         screen += '+';
@@ -365,16 +252,21 @@ struct TetrisGame {
         // Single output call
         cout << screen;
         cout.flush();
+
+        // The board has been painted over - repaint it fully next time
+        renderer.invalidate();
     }
 
     char waitForKeyPress() {
         // Enable raw mode to capture single key press
         enableRawMode();
 
-        // Wait for any key press
+        // Sleep until a key arrives
         char key = 0;
-        while ((key = getInput()) == 0) {
-            usleep(50000); // Sleep 50ms to avoid busy-waiting
+        while ((key = nextCommand()) == 0) {
+            int64_t escDeadline = input.pendingDeadline();
+            events.wait(escDeadline >= 0 ? escDeadline : EventLoop::NO_DEADLINE);
+            readInput();
         }
 
         // Flush any additional input
@@ -383,47 +275,23 @@ struct TetrisGame {
         return key;
     }
 
+    // Adds the finished game to the shared high score table and returns
+    // its rank there (past the table's end when it did not make it)
     int saveAndGetRank() {
-        // Read existing scores
-        vector<int> scores;
-        ifstream inFile("high_scores.txt");
-        if (inFile.is_open()) {
-            int score;
-            while (inFile >> score) {
-                scores.push_back(score);
-            }
-            inFile.close();
-        }
-
-        // Add current score
-        scores.push_back(state.score);
-
-        // Sort in descending order
-        sort(scores.begin(), scores.end(), greater<int>());
-
-        // Keep only top 10 scores
-        if (scores.size() > 10) {
-            scores.resize(10);
-        }
-
-        // Write back to file
-        ofstream outFile("high_scores.txt");
-        if (outFile.is_open()) {
-            for (int score : scores) {
-                outFile << score << "\n";
-            }
-            outFile.close();
-        }
-
-        // Find rank of current score
-        int rank = 1;
-        for (int score : scores) {
-            if (score == state.score) {
-                break;
-            }
-            rank++;
-        }
-
+        ScoreRecord record;
+        record.setName(options.playerName.c_str());
+        record.score = engine.state.score;
+        record.lines = engine.state.linesCleared;
+        record.level = engine.state.level;
+        record.durationMs = static_cast<uint32_t>(uint64_t{ticks} * 1000 / LOGIC_HZ);
+        record.timestamp = static_cast<int64_t>(time(nullptr));
+
+        ScoreStore store(HIGH_SCORE_FILE, LEGACY_HIGH_SCORE_FILE);
+        int rank = 0;
+        bool saved = store.add(record, rank);
+        scoreNote.clear();
+        if (!saved) scoreNote = "High score not saved";
+        else if (store.setAside) scoreNote = "Bad score file set aside";
         return rank;
     }
 
@@ -436,7 +304,7 @@ struct TetrisGame {
         screen += "\033[2J\033[1;1H";
 
         // Calculate width for game over screen
-        int totalWidth = BOARD_WIDTH + NEXT_PICE_WIDTH + 2;
+        int totalWidth = SCREEN_WIDTH;
 
         // Top border
         screen += '+';
@@ -467,7 +335,7 @@ struct TetrisGame {
 
         // Score display
         char scoreBuf[64];
-        snprintf(scoreBuf, sizeof(scoreBuf), "Final Score: %d", state.score);
+        snprintf(scoreBuf, sizeof(scoreBuf), "Final Score: %d", engine.state.score);
         string scoreStr(scoreBuf);
         int scorePadding = totalWidth - scoreStr.length();
         int scoreLeft = scorePadding / 2;
@@ -481,7 +349,7 @@ struct TetrisGame {
 
         // Level display
         char levelBuf[64];
-        snprintf(levelBuf, sizeof(levelBuf), "Level: %d", state.level);
+        snprintf(levelBuf, sizeof(levelBuf), "Level: %d", engine.state.level);
         string levelStr(levelBuf);
         int levelPadding = totalWidth - levelStr.length();
         int levelLeft = levelPadding / 2;
@@ -495,7 +363,7 @@ struct TetrisGame {
 
         // Lines display
         char linesBuf[64];
-        snprintf(linesBuf, sizeof(linesBuf), "Lines Cleared: %d", state.linesCleared);
+        snprintf(linesBuf, sizeof(linesBuf), "Lines Cleared: %d", engine.state.linesCleared);
         string linesStr(linesBuf);
         int linesPadding = totalWidth - linesStr.length();
         int linesLeft = linesPadding / 2;
@@ -512,14 +380,14 @@ struct TetrisGame {
         screen.append(totalWidth, ' ');
         screen += "|\n";
 
-        // Rank display with ordinal suffix
+        // Rank display with ordinal suffix; a versus match has a winner instead
         char rankBuf[64];
         const char* suffix = "th";
         if (rank == 1) suffix = "st";
         else if (rank == 2) suffix = "nd";
         else if (rank == 3) suffix = "rd";
         snprintf(rankBuf, sizeof(rankBuf), "Your Rank: %d%s", rank, suffix);
-        string rankStr(rankBuf);
+        string rankStr(versus ? versusResult() : rankBuf);
         int rankPadding = totalWidth - rankStr.length();
         int rankLeft = rankPadding / 2;
         int rankRight = rankPadding - rankLeft;
@@ -530,6 +398,17 @@ struct TetrisGame {
         screen.append(rankRight, ' ');
         screen += "|\n";
 
+        // High score file trouble, so a lost score is not silent
+        if (!versus && !scoreNote.empty()) {
+            int notePadding = totalWidth - static_cast<int>(scoreNote.length());
+            int noteLeft = notePadding / 2;
+            screen += '|';
+            screen.append(noteLeft, ' ');
+            screen += scoreNote;
+            screen.append(notePadding - noteLeft, ' ');
+            screen += "|\n";
+        }
+
         // Empty row
         screen += '|';
         screen.append(totalWidth, ' ');
@@ -560,35 +439,141 @@ struct TetrisGame {
         // Single output call
         cout << screen;
         cout.flush();
+
+        // The board has been painted over - repaint it fully next time
+        renderer.invalidate();
     }
 
     // ---------- helper methods ----------
 
     void resetGame() {
-        // Reset game state
-        state.running = true;
-        state.paused = false;
-        state.quitByUser = false;
-        state.score = 0;
-        state.level = 1;
-        state.linesCleared = 0;
-
-        // Reset board
-        board.init();
-
-        // Reset timing
-        dropCounter = 0;
-        softDropActive = false;
-
-        // Generate new next piece
-        uniform_int_distribution<int> dist(0, NUM_BLOCK_TYPES - 1);
-        nextPieceType = dist(rng);
-
-        // Spawn first piece
-        spawnNewPiece();
+        // Reset frontend state
+        paused = false;
+        quitByUser = false;
+
+        // No key is held into a new game
+        repeat.releaseAll();
+
+        // The first game may carry on from a snapshot instead
+        if (resumed) {
+            resumed = false;
+            return;
+        }
+
+        // New board, score and first pieces, from a seed the replay keeps
+        uint32_t gameSeed = seeder();
+        engine.seed(gameSeed);
+        engine.reset();
+        recording.start(gameSeed, engine.queue.generator.kind, Width, Height);
+        ticks = 0;
+
+        // Both players get the same pieces
+        if (versus) {
+            rival.seed(gameSeed);
+            rival.reset();
+        }
+    }
+
+    // Carry on from a snapshot instead of starting the first game
+    bool resume(const Snapshot& snapshot) {
+        if (!snapshot.restore(engine, ticks)) return false;
+        resumed = true;
+        return true;
+    }
+
+    // The game so far, to carry on later with --resume
+    void saveSnapshot() {
+        Snapshot snapshot;
+        snapshot.capture(engine, ticks);
+        bool saved = snapshot.save(options.snapshotPath.c_str());
+        notice = (saved ? "Snapshot saved to " : "Could not save snapshot to ") + options.snapshotPath;
+        noticeUntilNs = monotonicNowNs() + NOTICE_NS;
+    }
+
+    // All game input goes through here, so it lands in the recording
+    StepResult apply(Action action) {
+        recording.record(ticks, action);
+        StepResult result = engine.step(action);
+        if (versus) exchangeGarbage(engine, result, rival, StepResult{});
+        return result;
+    }
+
+    StepResult applyRival(Action action) {
+        StepResult result = rival.step(action);
+        exchangeGarbage(engine, StepResult{}, rival, result);
+        return result;
+    }
+
+    // In versus both boards step together; the result tells whether
+    // either of them changed
+    StepResult tickEngine() {
+        ++ticks;
+        StepResult result = engine.tick(Action::None, false);
+        if (versus) {
+            StepResult rivalResult = rival.tick(Action::None, false);
+            exchangeGarbage(engine, result, rival, rivalResult);
+            result.moved |= rivalResult.moved;
+            result.locked |= rivalResult.locked;
+            result.gameOver |= rivalResult.gameOver;
+        }
+        return result;
     }
 
-    void drawPauseScreen() const {
+    void saveRecording() {
+        recording.finish(ticks, engine.state);
+        if (!options.recordPath.empty()) {
+            recordSaved = recording.save(options.recordPath.c_str());
+        }
+    }
+
+    // A versus match ends when either player tops out
+    bool playing() const {
+        return engine.state.running && (!versus || rival.state.running) && !quitByUser;
+    }
+
+    const char* versusResult() const {
+        if (engine.state.running && rival.state.running) return "Match Stopped";
+        if (engine.state.running == rival.state.running) return "Draw";
+        return engine.state.running ? "Player 1 Wins" : "Player 2 Wins";
+    }
+
+    // Both boards side by side, below them the versus controls and the
+    // garbage each player has coming. The player's rows are in frame.rows.
+    TextFrame& assembleVersus() {
+        rivalCompositor.lockedLayer(rival.board);
+        if (rival.state.running) {
+            Piece landed = rival.calculateGhostPiece();
+            if (ghostEnabled && landed.pos.y != rival.currentPiece.pos.y) {
+                rivalCompositor.ghostLayer(landed);
+            }
+            rivalCompositor.pieceLayer(rival.currentPiece);
+        } else {
+            rivalCompositor.pieceLayer(rival.currentPiece, false);
+        }
+        rivalFrame.assemble(rivalCompositor.field, rival);
+
+        // The single player controls line makes way for our own
+        frame.rows.resize(Height + 4);
+        rivalFrame.rows.resize(Height + 4);
+        joinFrames(frame.rows, rivalFrame.rows, VERSUS_GAP, versusRows);
+
+        TextFrame::Line& controls = versusRows.lines[versusRows.count++];
+        controls.clear();
+        controls.append(rivalBot ? "P1: A/D (Move)  W (Rotate)  S (Soft Drop)  SPACE (Hard Drop)   P2: AI"
+                                 : "P1: A/D (Move)  W (Rotate)  S (Soft Drop)  SPACE (Hard Drop)   "
+                                   "P2: ←→ (Move)  ↑ (Rotate)  ↓ (Soft Drop)  ENTER (Hard Drop)");
+
+        TextFrame::Line& garbage = versusRows.lines[versusRows.count++];
+        garbage.clear();
+        garbage.append("Garbage coming: P1 ");
+        garbage.appendInt(engine.garbagePending);
+        garbage.append("  P2 ");
+        garbage.appendInt(rival.garbagePending);
+        garbage.append("    G (Ghost)  T (Timing)  P (Pause)  Q (Quit)");
+        return versusRows;
+    }
+
+    void drawPauseScreen() {
         // Build pause overlay in a string buffer
         string screen;
         screen.reserve(1024);
@@ -597,7 +582,7 @@ struct TetrisGame {
         screen += "\033[2J\033[1;1H";
 
         // Calculate width for pause screen
-        int totalWidth = BOARD_WIDTH + NEXT_PICE_WIDTH + 2;
+        int totalWidth = SCREEN_WIDTH;
 
         // Top border
         screen += '+';
@@ -630,7 +615,7 @@ struct TetrisGame {
 
         // Current stats - Score
         char scoreBuf[64];
-        snprintf(scoreBuf, sizeof(scoreBuf), "Score: %d", state.score);
+        snprintf(scoreBuf, sizeof(scoreBuf), "Score: %d", engine.state.score);
         string scoreStr(scoreBuf);
         int scorePadding = totalWidth - scoreStr.length();
         int scoreLeft = scorePadding / 2;
@@ -644,7 +629,7 @@ struct TetrisGame {
 
         // Level
         char levelBuf[64];
-        snprintf(levelBuf, sizeof(levelBuf), "Level: %d", state.level);
+        snprintf(levelBuf, sizeof(levelBuf), "Level: %d", engine.state.level);
         string levelStr(levelBuf);
         int levelPadding = totalWidth - levelStr.length();
         int levelLeft = levelPadding / 2;
@@ -658,7 +643,7 @@ struct TetrisGame {
 
         // Lines
         char linesBuf[64];
-        snprintf(linesBuf, sizeof(linesBuf), "Lines: %d", state.linesCleared);
+        snprintf(linesBuf, sizeof(linesBuf), "Lines: %d", engine.state.linesCleared);
         string linesStr(linesBuf);
         int linesPadding = totalWidth - linesStr.length();
         int linesLeft = linesPadding / 2;
@@ -713,37 +698,34 @@ struct TetrisGame {
         // Single output call
         cout << screen;
         cout.flush();
-    }
 
-    void getNextPiecePreview(string lines[4]) const {
-        // Render the next piece as 4 lines of 4 characters each
-        for (int row = 0; row < 4; ++row) {
-            lines[row] = "";
-            for (int col = 0; col < 4; ++col) {
-                char cell = BlockTemplate::getCell(nextPieceType, 0, row, col);
-                lines[row] += cell;
-            }
-        }
+        // The board has been painted over - repaint it fully next time
+        renderer.invalidate();
     }
 
+    // Animates the last composed playfield, which the caller has left in
+    // compositor.field; the board itself is not touched
     void animateGameOver() {
         // Transform all locked pieces to '#' one by one from bottom to top
         // This creates a cascade effect showing the game is ending
 
-        constexpr int ANIM_DELAY_US = 15000; // 15ms per cell for smooth animation
+        // 15ms per cell on the default board for smooth animation; other
+        // sizes keep the same total length
+        constexpr int ANIM_DELAY_US =
+            15000 * DEFAULT_BOARD_WIDTH * DEFAULT_BOARD_HEIGHT / (Width * Height);
+
+        Playfield<Width, Height>& field = compositor.field;
 
         // Scan from bottom to top, left to right
-        for (int i = BOARD_HEIGHT - 1; i >= 0; --i) {
+        for (int i = Height - 1; i >= 0; --i) {
             bool hasBlock = false;
-            for (int j = 0; j < BOARD_WIDTH; ++j) {
-                if (board.grid[i][j] != ' ') {
+            for (int j = 0; j < Width; ++j) {
+                if (field.cells[i][j] != ' ') {
                     hasBlock = true;
-                    board.grid[i][j] = '#';
+                    field.cells[i][j] = '#';
 
                     // Draw immediately for smooth animation
-                    string preview[4];
-                    getNextPiecePreview(preview);
-                    board.draw(state, preview);
+                    drawBoard(field);
 
                     usleep(ANIM_DELAY_US);
                 }
@@ -762,6 +744,8 @@ struct TetrisGame {
     // ---------- terminal handling (POSIX) ----------
 
     void enableRawMode() {
+        if (rawMode) return;
+        rawMode = true;
         tcgetattr(STDIN_FILENO, &origTermios);
 
         termios raw = origTermios;
@@ -776,511 +760,393 @@ struct TetrisGame {
     }
 
     void disableRawMode() {
-        tcsetattr(STDIN_FILENO, TCSAFLUSH, &origTermios);
-    }
-
-    char getInput() const {
-        char ch = 0;
-        ssize_t result = read(STDIN_FILENO, &ch, 1);
-        if (result <= 0) return 0;
-
-        // Detect arrow keys (escape sequences)
-        // Arrow keys send: ESC [ A/B/C/D
-        if (ch == 27) { // ESC
-            char seq[2];
-            if (read(STDIN_FILENO, &seq[0], 1) <= 0) return 27;
-            if (read(STDIN_FILENO, &seq[1], 1) <= 0) return 27;
-
-            if (seq[0] == '[') {
-                switch (seq[1]) {
-                    case 'A': return 'w'; // Up arrow -> rotate
-                    case 'B': return 's'; // Down arrow -> soft drop
-                    case 'C': return 'd'; // Right arrow -> move right
-                    case 'D': return 'a'; // Left arrow -> move left
-                }
-            }
-            return 27;
+        if (kittyKeyboard) {
+            // Pop our keyboard mode so the shell gets plain keys back
+            cout << "\033[<u";
+            cout.flush();
+            kittyKeyboard = false;
         }
-
-        return ch;
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &origTermios);
+        rawMode = false;
     }
 
-    void flushInput() const {
-        tcflush(STDIN_FILENO, TCIFLUSH);
+    // Ask whether the terminal speaks the kitty keyboard protocol. Only
+    // terminals that do answer (CSI ? flags u); the reply is handled in
+    // nextEvent() whenever it arrives.
+    void queryKeyboardProtocol() {
+        if (!options.kittyKeyboard) return;
+        cout << "\033[?u";
+        cout.flush();
     }
 
-    // ---------- helpers for spawn / movement ----------
-
-    bool isInsidePlayfield(int x, int y) const {
-        return x >= 0 && x < BOARD_WIDTH &&
-               y >= 0 && y < BOARD_HEIGHT;
+    void enableKittyKeyboard() {
+        if (kittyKeyboard || !options.kittyKeyboard) return;
+        cout << "\033[>" << KITTY_KEYBOARD_FLAGS << 'u';
+        cout.flush();
+        kittyKeyboard = true;
+        repeat.releaseEvents = true;
+        repeat.releaseAll();
     }
 
-    // Calculate where the current piece would land if dropped straight down
-    Piece calculateGhostPiece() const {
-        Piece ghost = currentPiece;
-
-        // Keep moving down until we hit something
-        // Check collision only with locked pieces (not dots or current piece)
-        bool canMoveDown = true;
-        while (canMoveDown) {
-            canMoveDown = false;
-
-            // Check if ghost can move down one more position
-            for (int i = 0; i < BLOCK_SIZE; ++i) {
-                for (int j = 0; j < BLOCK_SIZE; ++j) {
-                    char cell = BlockTemplate::getCell(ghost.type, ghost.rotation, i, j);
-                    if (cell == ' ') continue;
-
-                    int xt = ghost.pos.x + j;
-                    int yt = ghost.pos.y + i + 1;  // +1 for next position
-
-                    // Check bounds
-                    if (yt >= BOARD_HEIGHT) {
-                        canMoveDown = false;
-                        goto done_checking;
-                    }
-
-                    // Check collision with LOCKED pieces only (not dots or spaces)
-                    // Locked pieces are letters (I, O, T, S, Z, J, L) or '#'
-                    if (yt >= 0) {
-                        char gridCell = board.grid[yt][xt];
-                        if (gridCell != ' ' && gridCell != '.') {
-                            canMoveDown = false;
-                            goto done_checking;
-                        }
-                    }
-                }
-            }
-
-            canMoveDown = true;
-            done_checking:
-
-            if (canMoveDown) {
-                ghost.pos.y++;
-            }
-        }
-
-        return ghost;
+    // Pull everything the terminal has sent so far into the decoder
+    void readInput() {
+        int64_t now = monotonicNowNs();
+        input.fill(STDIN_FILENO, now);
+        input.expire(now);
     }
 
-    // Check if piece can spawn: verify bounds and no collision with existing blocks
-    bool canSpawn(const Piece& piece) const {
-        for (int i = 0; i < BLOCK_SIZE; ++i) {
-            for (int j = 0; j < BLOCK_SIZE; ++j) {
-                char cell = BlockTemplate::getCell(piece.type, piece.rotation, i, j);
-                if (cell == ' ') continue;
-
-                int xt = piece.pos.x + j;
-                int yt = piece.pos.y + i;
-
-                // Check horizontal bounds
-                if (xt < 0 || xt >= BOARD_WIDTH) return false;
-
-                // Check vertical bounds (bottom)
-                if (yt >= BOARD_HEIGHT) return false;
-
-                // Check collision with LOCKED blocks only (ignore ghost dots)
-                if (yt >= 0) {
-                    char gridCell = board.grid[yt][xt];
-                    if (gridCell != ' ' && gridCell != '.') {
-                        return false;
-                    }
-                }
+    // Next queued key event; terminal replies are handled here
+    bool nextEvent(KeyEvent& event) {
+        while (input.next(event)) {
+            if (event.key == Key::KeyboardFlags) {
+                enableKittyKeyboard();
+                continue;
             }
+            return true;
         }
-        return true;
+        return false;
     }
 
-    bool canMove(int dx, int dy, int newRotation) const {
-        for (int i = 0; i < BLOCK_SIZE; ++i) {
-            for (int j = 0; j < BLOCK_SIZE; ++j) {
-                char cell = BlockTemplate::getCell(
-                    currentPiece.type, newRotation, i, j
-                );
-                if (cell == ' ') continue;
-
-                int xt = currentPiece.pos.x + j + dx;
-                int yt = currentPiece.pos.y + i + dy;
-
-                // horizontal bounds (full playable area 0..BOARD_WIDTH-1)
-                if (xt < 0 || xt >= BOARD_WIDTH) return false;
-
-                // bottom collision with floor or blocks
-                if (yt >= BOARD_HEIGHT) return false;
-
-                // Check collision with LOCKED pieces only (ignore ghost dots)
-                if (yt >= 0) {
-                    char gridCell = board.grid[yt][xt];
-                    if (gridCell != ' ' && gridCell != '.') {
-                        return false;
-                    }
-                }
-            }
+    // Next key press as a command character, 0 when there is none
+    char nextCommand() {
+        KeyEvent event;
+        while (nextEvent(event)) {
+            if (event.action == KeyAction::Release) continue;
+            char c = commandForKey(event);
+            if (c != 0) return c;
         }
-        return true;
+        return 0;
     }
 
-    void placePiece(const Piece& piece, bool place) {
-        for (int i = 0; i < BLOCK_SIZE; ++i) {
-            for (int j = 0; j < BLOCK_SIZE; ++j) {
-                char cell = BlockTemplate::getCell(
-                    piece.type, piece.rotation, i, j
-                );
-                if (cell == ' ') continue;
-
-                int xt = piece.pos.x + j;
-                int yt = piece.pos.y + i;
-
-                if (yt < 0 || yt >= BOARD_HEIGHT ||
-                    xt < 0 || xt >= BOARD_WIDTH) {
-                    continue;
-                }
-
-                board.grid[yt][xt] = place ? cell : ' ';
-            }
-        }
+    void flushInput() {
+        tcflush(STDIN_FILENO, TCIFLUSH);
+        input.clear();
+        // Releases may have been flushed with the rest
+        repeat.releaseAll();
     }
 
-    void clearAllGhostDots() {
-        // Clear all ghost dots from the board
-        for (int i = 0; i < BOARD_HEIGHT; ++i) {
-            for (int j = 0; j < BOARD_WIDTH; ++j) {
-                if (board.grid[i][j] == '.') {
-                    board.grid[i][j] = ' ';
-                }
-            }
+    static bool repeatKeyFor(char c, RepeatKey& key) {
+        switch (c) {
+            case 'a': key = REPEAT_LEFT; return true;
+            case 'd': key = REPEAT_RIGHT; return true;
+            case 's': key = REPEAT_DOWN; return true;
+            default: return false;
         }
     }
 
-    void placeGhostPiece(const Piece& ghostPiece) {
-        // Place ghost piece using '.' character for outline effect
-        for (int i = 0; i < BLOCK_SIZE; ++i) {
-            for (int j = 0; j < BLOCK_SIZE; ++j) {
-                char cell = BlockTemplate::getCell(
-                    ghostPiece.type, ghostPiece.rotation, i, j
-                );
-                if (cell == ' ') continue;
-
-                int xt = ghostPiece.pos.x + j;
-                int yt = ghostPiece.pos.y + i;
-
-                if (yt < 0 || yt >= BOARD_HEIGHT ||
-                    xt < 0 || xt >= BOARD_WIDTH) {
-                    continue;
-                }
-
-                // Only draw ghost where there's empty space (don't overwrite actual pieces)
-                if (board.grid[yt][xt] == ' ') {
-                    board.grid[yt][xt] = '.';
-                }
+    // Perform count moves of a held key; stops early at a wall or the stack.
+    // Soft drop never locks the piece, that is left to the lock delay.
+    bool applyRepeat(RepeatKey key, int count) {
+        bool moved = false;
+        for (int i = 0; i < count; ++i) {
+            if (key == REPEAT_DOWN) {
+                if (!engine.canMove(0, 1, engine.currentPiece.rotation)) break;
+                apply(Action::Down);
+            } else if (!apply(key == REPEAT_LEFT ? Action::MoveLeft
+                                                 : Action::MoveRight).moved) {
+                break;
             }
+            moved = true;
         }
+        return moved;
     }
 
-    void placePieceSafe(const Piece& piece) {
-        // Place piece without overwriting existing blocks
-        // Used for game over visualization to show collision without overlap
-        for (int i = 0; i < BLOCK_SIZE; ++i) {
-            for (int j = 0; j < BLOCK_SIZE; ++j) {
-                char cell = BlockTemplate::getCell(
-                    piece.type, piece.rotation, i, j
-                );
-                if (cell == ' ') continue;
-
-                int xt = piece.pos.x + j;
-                int yt = piece.pos.y + i;
-
-                if (yt < 0 || yt >= BOARD_HEIGHT ||
-                    xt < 0 || xt >= BOARD_WIDTH) {
-                    continue;
-                }
-
-                // Only place if cell is empty - don't overwrite existing blocks
-                if (board.grid[yt][xt] == ' ') {
-                    board.grid[yt][xt] = cell;
-                }
-            }
+    // Player 2 in versus: the arrows move, rotate and soft drop, Enter
+    // hard drops. Held keys follow the terminal's own key repeat. Returns
+    // false for keys that are not player 2's.
+    bool handleRivalEvent(const KeyEvent& event) {
+        Action action;
+        switch (event.key) {
+            case Key::Left: action = Action::MoveLeft; break;
+            case Key::Right: action = Action::MoveRight; break;
+            case Key::Up: action = Action::Rotate; break;
+            case Key::Down: action = Action::Down; break;
+            case Key::Enter: action = Action::HardDrop; break;
+            default: return false;
         }
+        if (event.action == KeyAction::Release || paused) return true;
+        if (event.action == KeyAction::Repeat && action == Action::HardDrop) return true;
+        // Soft drop leaves locking to the lock delay, as for player 1
+        if (action == Action::Down && !rival.canMove(0, 1, rival.currentPiece.rotation)) return true;
+        applyRival(action);
+        return true;
     }
 
-    void spawnNewPiece() {
-        uniform_int_distribution<int> dist(0, NUM_BLOCK_TYPES - 1);
-
-        // Create temporary piece to test spawn
-        Piece testPiece;
-        testPiece.type = nextPieceType;
-        testPiece.rotation = 0;
-
-        // Spawn near horizontal center, above visible board (y=-1)
-        // This makes pieces appear from above the divider line
-        int spawnX = (BOARD_WIDTH / 2) - (BLOCK_SIZE / 2);
-        testPiece.pos = Position(spawnX, -1);
-
-        // Always set currentPiece so it can be displayed even on game over
-        currentPiece = testPiece;
+    // Movement keys go through auto-repeat, everything else acts on press
+    void handleEvent(const KeyEvent& event) {
+        if (versus && !rivalBot && handleRivalEvent(event)) return;
+        char c = commandForKey(event);
+        if (c == 0) return;
+        // The AI is playing: only pause, ghost, stats, snapshot and quit
+        if (bot && c != 'p' && c != 'g' && c != 't' && c != 'v' && c != 'q') return;
 
-        // Check if spawn is possible - if blocks at y=0 collide, game over
-        if (!canSpawn(testPiece)) {
-            state.running = false;
+        RepeatKey key;
+        if (repeatKeyFor(c, key)) {
+            int count = repeat.onEvent(key, event.action, event.timeNs);
+            if (!paused) applyRepeat(key, count);
             return;
         }
 
-        // Spawn is valid, generate new next piece
-        nextPieceType = dist(rng);
-    }
-
-    bool lockPieceAndCheck() {
-        // permanently place current piece
-        placePiece(currentPiece, true);
-
-        // Clear lines and update score
-        int lines = board.clearLines();
-        if (lines > 0) {
-            state.linesCleared += lines;
-
-            // Standard Tetris scoring: 1=40, 2=100, 3=300, 4=1200
-            const int scores[] = {0, 40, 100, 300, 1200};
-            state.score += scores[lines] * state.level;
-
-            // Level up every 10 lines
-            state.level = 1 + (state.linesCleared / 10);
-        }
-
-        // Try to spawn next piece - if it fails, game over
-        spawnNewPiece();
-        return state.running;
-    }
-
-    void softDrop() {
-        if (canMove(0, 1, currentPiece.rotation)) {
-            currentPiece.pos.y++;
-        } else {
-            // Don't lock if piece is still above visible board
-            if (currentPiece.pos.y < 0) {
-                state.running = false;
-                return;
-            }
-            state.running = lockPieceAndCheck();
-            dropCounter = 0;
-        }
+        if (event.action == KeyAction::Release) return;
+        // A held hard drop key must not drop every following piece
+        if (event.action == KeyAction::Repeat && c == ' ') return;
+        apply(handleKey(c));
     }
 
-    void hardDrop() {
-        // Drop piece to the lowest possible position
-        while (canMove(0, 1, currentPiece.rotation)) {
-            currentPiece.pos.y++;
-        }
-        // Don't lock if piece is still above visible board
-        if (currentPiece.pos.y < 0) {
-            state.running = false;
-            return;
+    // Landing position of the current piece, cached against the piece
+    // position and the board revision
+    const Piece& ghostPiece() {
+        const Piece& piece = engine.currentPiece;
+        if (!ghostValid || ghostRevision != engine.board.revision ||
+            ghostFor.type != piece.type || ghostFor.rotation != piece.rotation ||
+            ghostFor.pos.x != piece.pos.x || ghostFor.pos.y != piece.pos.y) {
+            ghost = engine.calculateGhostPiece();
+            ghostFor = piece;
+            ghostRevision = engine.board.revision;
+            ghostValid = true;
         }
-        state.running = lockPieceAndCheck();
-        dropCounter = 0;
+        return ghost;
     }
 
-    void handleInput() {
-        char c = getInput();
-
-        // Always update soft drop state based on current input
-        // This ensures it's immediately deactivated when 's' is released
-        if (c == 's' && !state.paused) {
-            softDropActive = true;
-        } else {
-            softDropActive = false;
-        }
-
-        if (c == 0) return;
-
+    // Handle frontend keys; game moves are returned as an Action.
+    // Left/right/soft drop ('a'/'d'/'s') are handled by handleEvent().
+    Action handleKey(char c) {
         // Handle pause input regardless of pause state
         if (c == 'p') {
-            state.paused = !state.paused;
-            flushInput(); // Clear input buffer when toggling pause
-            if (state.paused) {
+            paused = !paused;
+            flushInput(); // Clear input buffer and held keys when toggling pause
+            if (paused) {
                 drawPauseScreen();
             }
-            return;
+            return Action::None;
         }
 
         // Handle ghost toggle (can toggle even when paused)
         if (c == 'g') {
-            state.ghostEnabled = !state.ghostEnabled;
-            return;
+            ghostEnabled = !ghostEnabled;
+            return Action::None;
+        }
+
+        // Frame timing HUD, fresh numbers as soon as it shows
+        if (c == 't') {
+            statsVisible = !statsVisible;
+            statsShownNs = 0;
+            return Action::None;
+        }
+
+        // Save a snapshot, also when paused
+        if (c == 'v') {
+            if (!versus) saveSnapshot();
+            return Action::None;
         }
 
         // If paused, only allow quit and pause toggle
-        if (state.paused) {
+        if (paused) {
             if (c == 'q') {
-                state.running = false;
-                state.quitByUser = true;
+                quitByUser = true;
             }
-            return;
+            return Action::None;
         }
 
         // Game is not paused - handle normal inputs
         switch (c) {
-            case 'a': // move left
-                if (canMove(-1, 0, currentPiece.rotation)) {
-                    currentPiece.pos.x--;
-                }
-                break;
-            case 'd': // move right
-                if (canMove(1, 0, currentPiece.rotation)) {
-                    currentPiece.pos.x++;
-                }
-                break;
-            case 's': // soft drop (hold) - handled by gravity system
-                // Just keep softDropActive = true (already set above)
-                break;
             case 'x': // soft drop one cell (instant)
-                softDrop();
-                break;
+                return Action::Down;
             case ' ': // hard drop
-                hardDrop();
-                flushInput(); // flush repeated spaces
-                break;
-            case 'w': { // rotate with extended wall kicks
-                int newRot = (currentPiece.rotation + 1) % 4;
-                // Extended wall kick offsets to handle S/Z blocks near edges
-                int kicks[] = {0, -1, 1, -2, 2, -3, 3};
-                for (int dx : kicks) {
-                    if (canMove(dx, 0, newRot)) {
-                        currentPiece.pos.x += dx;
-                        currentPiece.rotation = newRot;
-                        break;
-                    }
-                }
-                break;
-            }
+                // Legacy terminals: flush repeated spaces (kitty marks them)
+                if (!kittyKeyboard) flushInput();
+                return Action::HardDrop;
+            case 'w': // rotate with extended wall kicks
+                return Action::Rotate;
             case 'q':
-                state.running = false;
-                state.quitByUser = true;
-                break;
+                quitByUser = true;
+                return Action::None;
             default:
-                break;
+                return Action::None;
         }
     }
 
-    void handleGravity() {
-        if (!state.running || state.paused) return;
-
-        ++dropCounter;
+    // Compose the layers (locked cells, ghost, falling piece) and draw.
+    // Nothing is written into the board.
+    void renderFrame() {
+        // The ghost first, so the layers are timed in one piece
+        const Piece* landed = nullptr;
+        if (ghostEnabled) {
+            int64_t ghostStart = monotonicNowNs();
+            landed = &ghostPiece();
+            stats.add(PHASE_GHOST, monotonicNowNs() - ghostStart);
+        }
 
-        // Use faster drop interval when soft drop is active
-        int effectiveInterval = softDropActive ? 1 : DROP_INTERVAL_TICKS;
+        int64_t start = monotonicNowNs();
+        compositor.lockedLayer(engine.board);
 
-        if (dropCounter < effectiveInterval) return;
+        // Only draw ghost if it's different from current piece position
+        if (landed && landed->pos.y != engine.currentPiece.pos.y) {
+            compositor.ghostLayer(*landed);
+        }
 
-        dropCounter = 0;
+        compositor.pieceLayer(engine.currentPiece);
+        stats.add(PHASE_COMPOSE, monotonicNowNs() - start);
 
-        if (canMove(0, 1, currentPiece.rotation)) {
-            currentPiece.pos.y++;
-        } else {
-            // Don't lock if piece is still above visible board (y < 0)
-            // This means the board is full at the top - game over
-            if (currentPiece.pos.y < 0) {
-                state.running = false;
-                return;
-            }
-            state.running = lockPieceAndCheck();
-        }
+        drawBoard(compositor.field);
     }
 
     void run() {
-        BlockTemplate::initializeTemplates();
+        TerminalRenderer::installResizeHandler();
+
+        // Raw mode first, so the protocol reply is not echoed
+        enableRawMode();
+        queryKeyboardProtocol();
 
         // Main game loop with restart support
         bool shouldRestart = true;
 
         while (shouldRestart) {
             // Reset for new game
-            board.init();
-
-            // Initialize the first next piece
-            uniform_int_distribution<int> dist(0, NUM_BLOCK_TYPES - 1);
-            nextPieceType = dist(rng);
+            resetGame();
 
             // Show start screen and wait for key press (only on first run)
             static bool firstRun = true;
-            if (firstRun) {
+            if (firstRun && !bot) {
                 drawStartScreen();
                 waitForKeyPress();
                 firstRun = false;
             }
 
-            // Spawn first piece
-            spawnNewPiece();
+            // Game loop: logic runs on a fixed LOGIC_HZ timestep from the
+            // monotonic clock, keys are applied as soon as they arrive and
+            // the frame is redrawn only when something changed, at most
+            // RENDER_HZ times per second
+            const int64_t renderStepNs = 1000000000 / RENDER_HZ;
+            FixedTimestep logic;
+            logic.start(LOGIC_HZ, monotonicNowNs());
+            int64_t nextRenderNs = 0;
+            bool dirty = true;
+            const int64_t botStepNs = 1000000000 / AUTOPLAY_INPUT_HZ;
+            int64_t nextBotNs = 0;
+
+            while (playing()) {
+                int64_t deadline = EventLoop::NO_DEADLINE;
+                if (!paused) {
+                    deadline = logic.deadline();
+                    if (dirty && nextRenderNs < deadline) deadline = nextRenderNs;
+                    int64_t repeatDeadline = repeat.deadline();
+                    if (repeatDeadline >= 0 && repeatDeadline < deadline) {
+                        deadline = repeatDeadline;
+                    }
+                    if ((bot || rivalBot) && nextBotNs < deadline) deadline = nextBotNs;
+                }
+                int64_t escDeadline = input.pendingDeadline();
+                if (escDeadline >= 0 && (deadline < 0 || escDeadline < deadline)) {
+                    deadline = escDeadline;
+                }
+
+                int64_t waitStart = monotonicNowNs();
+                int wake = events.wait(deadline);
+                int64_t woke = monotonicNowNs();
+                if (deadline != EventLoop::NO_DEADLINE) {
+                    stats.add(PHASE_LATE, woke - max(deadline, waitStart));
+                }
 
-            // Game loop
-            while (state.running) {
-                handleInput();
+                // One read for everything pending, then every decoded key
+                if (wake & EventLoop::WAKE_INPUT) {
+                    readInput();
+                } else {
+                    input.expire(woke);
+                }
+                if (input.hasEvents()) {
+                    bool wasPaused = paused;
+                    KeyEvent event;
+                    while (playing() && nextEvent(event)) {
+                        handleEvent(event);
+                        dirty = true;
+                    }
+
+                    // Resume with a full step before anything falls
+                    if (wasPaused && !paused) {
+                        logic.start(LOGIC_HZ, monotonicNowNs());
+                    }
+                }
+                stats.add(PHASE_INPUT, monotonicNowNs() - woke);
 
                 // If user quit, exit immediately without rendering
-                if (!state.running) {
+                if (!playing()) {
                     break;
                 }
 
-                // Skip game logic and rendering when paused
-                if (state.paused) {
-                    usleep(50000); // Sleep 50ms to avoid busy-waiting
+                // Nothing runs or renders while paused
+                if (paused) {
                     continue;
                 }
 
-                handleGravity();
-
-                // Clear all ghost dots from previous frame
-                clearAllGhostDots();
+                int64_t now = monotonicNowNs();
 
-                // Calculate and draw ghost position (if enabled)
-                if (state.ghostEnabled) {
-                    Piece ghostPiece = calculateGhostPiece();
-                    // Only draw ghost if it's different from current piece position
-                    if (ghostPiece.pos.y != currentPiece.pos.y) {
-                        placeGhostPiece(ghostPiece);
+                // Held keys repeat on their own schedule, between logic steps
+                for (int key = 0; key < REPEAT_KEYS; ++key) {
+                    int count = repeat.due(static_cast<RepeatKey>(key), now);
+                    if (count > 0 && applyRepeat(static_cast<RepeatKey>(key), count)) {
+                        dirty = true;
                     }
                 }
+                stats.add(PHASE_GRAVITY, monotonicNowNs() - now);
+
+                if ((bot || rivalBot) && now >= nextBotNs) {
+                    int64_t searchStart = monotonicNowNs();
+                    if (bot) apply(bot->nextAction(engine));
+                    if (rivalBot && playing()) applyRival(rivalBot->nextAction(rival));
+                    dirty = true;
+                    nextBotNs = now + botStepNs;
+                    stats.add(PHASE_AI, monotonicNowNs() - searchStart);
+                }
 
-                // Draw current piece on top
-                placePiece(currentPiece, true);
-
-                // Render the frame
-                string preview[4];
-                getNextPiecePreview(preview);
-                board.draw(state, preview);
-
-                // Clear current piece from board for next frame
-                placePiece(currentPiece, false);
+                int64_t ticksStart = monotonicNowNs();
+                for (int steps = logic.due(now); steps > 0 && playing(); --steps) {
+                    StepResult result = tickEngine();
+                    if (result.moved || result.locked || result.gameOver) {
+                        dirty = true;
+                    }
+                }
+                stats.add(PHASE_GRAVITY, monotonicNowNs() - ticksStart);
 
-                usleep(dropSpeedUs / DROP_INTERVAL_TICKS);
+                if (dirty && now >= nextRenderNs && playing()) {
+                    renderFrame();
+                    dirty = false;
+                    nextRenderNs = now + renderStepNs;
+                }
             }
 
-            // Game over - show final board state with the last piece (only if player lost)
-            if (!state.quitByUser) {
-                placePieceSafe(currentPiece);
+            saveRecording();
 
-                string preview[4];
-                getNextPiecePreview(preview);
-                board.draw(state, preview);
+            // Game over - show final board state with the last piece (only if player lost)
+            if (!quitByUser) {
+                drawToppedOut();
 
                 // Brief pause to see the collision point
                 flushInput();
                 usleep(800000); // 800ms to see the final state
                 flushInput();
 
-                // Animate all locked pieces (including the final one) transforming to '#'
-                animateGameOver();
+                // Animate all locked pieces (including the final one) transforming
+                // to '#'; in versus the loser may be either board, so not there
+                if (!versus) animateGameOver();
             }
 
-            // Show game over screen and wait for user choice
-            int rank = saveAndGetRank();
+            // Attract mode starts over until the user quits, and the AI's
+            // scores stay off the high score table
+            if (bot) {
+                shouldRestart = !quitByUser;
+                continue;
+            }
+
+            // Show game over screen and wait for user choice; versus games
+            // are not single player scores
+            int rank = versus ? 0 : saveAndGetRank();
             drawGameOverScreen(rank);
 
             char choice = waitForKeyPress();
 
             if (choice == 'r' || choice == 'R') {
-                // Restart the game
-                resetGame();
+                // Restart the game (reset at the top of the loop)
                 shouldRestart = true;
             } else {
                 // Quit the game
@@ -1290,10 +1156,358 @@ struct TetrisGame {
 
         disableRawMode();
     }
+
+    // Final board with the piece that could not fit, without hiding the stack
+    void drawToppedOut() {
+        compositor.lockedLayer(engine.board);
+        compositor.pieceLayer(engine.currentPiece, false);
+
+        drawBoard(compositor.field);
+    }
+
+    // Play a recording back in real time through the normal renderer.
+    // Only P (pause), G (ghost), T (timing) and Q (stop) are read from the
+    // keyboard.
+    // Returns false when playback was stopped before the end.
+    bool runReplay(ReplayCursor<Engine>& cursor) {
+        TerminalRenderer::installResizeHandler();
+        enableRawMode();
+
+        FixedTimestep logic;
+        logic.start(LOGIC_HZ, monotonicNowNs());
+        bool dirty = true;
+
+        while (!cursor.done() && !quitByUser) {
+            int64_t deadline = paused ? EventLoop::NO_DEADLINE : logic.deadline();
+            int64_t escDeadline = input.pendingDeadline();
+            if (escDeadline >= 0 && (deadline < 0 || escDeadline < deadline)) {
+                deadline = escDeadline;
+            }
+
+            int64_t waitStart = monotonicNowNs();
+            int wake = events.wait(deadline);
+            int64_t woke = monotonicNowNs();
+            if (deadline != EventLoop::NO_DEADLINE) {
+                stats.add(PHASE_LATE, woke - max(deadline, waitStart));
+            }
+
+            if (wake & EventLoop::WAKE_INPUT) {
+                readInput();
+            } else {
+                input.expire(woke);
+            }
+
+            bool wasPaused = paused;
+            char c;
+            while ((c = nextCommand()) != 0) {
+                if (c == 'p' || c == 'g' || c == 't' || c == 'q') {
+                    handleKey(c);
+                    dirty = true;
+                }
+            }
+            if (wasPaused && !paused) {
+                logic.start(LOGIC_HZ, monotonicNowNs());
+            }
+            if (paused) continue;
+
+            int64_t now = monotonicNowNs();
+            stats.add(PHASE_INPUT, now - woke);
+            for (int steps = logic.due(now); steps > 0 && !cursor.done(); --steps) {
+                StepResult result = cursor.stepTick();
+                if (result.moved || result.locked || result.gameOver) {
+                    dirty = true;
+                }
+            }
+            stats.add(PHASE_GRAVITY, monotonicNowNs() - now);
+
+            if (dirty && !cursor.done()) {
+                renderFrame();
+                dirty = false;
+            }
+        }
+
+        bool finished = !quitByUser;
+        if (finished) {
+            // Inputs recorded after the last tick, then the final state
+            cursor.stepTick();
+            if (engine.state.running) {
+                renderFrame();
+            } else {
+                drawToppedOut();
+            }
+            usleep(800000);
+        }
+
+        disableRawMode();
+        return finished;
+    }
 };
 
-int main() {
-    TetrisGame game;
+// A replay is the seed plus every input since the first piece, so a game
+// resumed from a snapshot has none. main() refuses --record with --resume;
+// this keeps a later change to those checks from writing a replay that
+// cannot be played back.
+bool recordsResumedGame(const FrontendOptions& options) {
+    if (options.resumePath.empty() || options.recordPath.empty()) return false;
+    fprintf(stderr, "cannot record a game resumed from a snapshot\n");
+    return true;
+}
+
+// --autoplay --headless: the AI plays one game at full speed, without
+// gravity, and the result is printed. --record saves it as a replay.
+template <int Width, int Height>
+int autoplayMain(const FrontendOptions& options, const Snapshot& snapshot) {
+    using AutoPlayer = BasicAutoPlayer<Width, Height>;
+    uint32_t seed = options.fixedSeed ? options.seed : random_device{}();
+    BasicEngine<Width, Height> engine;
+    engine.configure(options.randomizer, options.previewDepth);
+    engine.seed(seed);
+    engine.reset();
+
+    // --resume: the AI takes over the saved position
+    uint32_t ticks = 0;
+    if (!options.resumePath.empty() && !snapshot.restore(engine, ticks)) {
+        fprintf(stderr, "cannot restore snapshot %s\n", options.resumePath.c_str());
+        return 1;
+    }
+
+    if (recordsResumedGame(options)) return 2;
+    Replay recording;
+    recording.start(seed, options.randomizer, Width, Height);
+    unique_ptr<AutoPlayer> bot = makeAutoPlayer<Width, Height>(options);
+
+    Action path[AutoPlayer::MAX_PATH];
+    int pieces = 0;
+    int64_t start = monotonicNowNs();
+    while (engine.state.running && pieces < options.maxPieces) {
+        int length = bot->planPath(engine, path, AutoPlayer::MAX_PATH);
+        if (length == 0) {
+            // Every placement tops out
+            path[0] = Action::HardDrop;
+            length = 1;
+        }
+        for (int i = 0; i < length; ++i) {
+            recording.record(0, path[i]);
+            engine.step(path[i]);
+        }
+        ++pieces;
+    }
+    double seconds = (monotonicNowNs() - start) / 1e9;
+
+    printf("autoplay: score %d, lines %d, level %d after %d pieces%s\n",
+           engine.state.score, engine.state.linesCleared, engine.state.level, pieces,
+           engine.state.running ? "" : " (topped out)");
+    printf("%.3f s, %.0f pieces/sec (%zu search threads, beam %d, lookahead %d)\n",
+           seconds, seconds > 0 ? pieces / seconds : 0.0, bot->workers.size(),
+           bot->beamWidth, min(bot->lookahead, engine.queue.depth));
+
+    recording.finish(0, engine.state);
+    if (!options.recordPath.empty() && !recording.save(options.recordPath.c_str())) {
+        fprintf(stderr, "could not write replay %s\n", options.recordPath.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+template <typename GameEngine>
+void printReplayResult(const ReplayCursor<GameEngine>& cursor) {
+    const GameState& state = cursor.engine.state;
+    const GameState& recorded = cursor.replay.result;
+    printf("replay: score %d, lines %d, level %d after %u ticks - %s\n",
+           state.score, state.linesCleared, state.level, cursor.ticks,
+           cursor.matches() ? "matches the recording" : "MISMATCH");
+    if (!cursor.matches()) {
+        printf("recorded: score %d, lines %d, level %d after %u ticks\n",
+               recorded.score, recorded.linesCleared, recorded.level,
+               cursor.replay.totalTicks);
+    }
+}
+
+// --replay: real time in the terminal, or --headless at full speed, on
+// the board size of the recording.
+// Exit status 0 when the final state matches the recording.
+template <int Width, int Height>
+int replayMain(const FrontendOptions& options, const Replay& replay) {
+    if (options.headless) {
+        BasicEngine<Width, Height> engine;
+        ReplayCursor cursor(replay, engine);
+        int64_t start = monotonicNowNs();
+        cursor.runToEnd();
+        double seconds = (monotonicNowNs() - start) / 1e9;
+
+        printReplayResult(cursor);
+        printf("%zu inputs, %.3f ms (%.0f ticks/sec)\n", replay.events.size(),
+               seconds * 1e3, seconds > 0 ? cursor.ticks / seconds : 0.0);
+        return cursor.matches() ? 0 : 1;
+    }
+
+    TetrisGame<Width, Height> game(options);
+    ReplayCursor cursor(replay, game.engine);
+    bool finished = game.runReplay(cursor);
+    if (options.frameStats) game.stats.print(stderr);
+    if (!finished) {
+        printf("replay stopped after %u of %u ticks\n", cursor.ticks, replay.totalTicks);
+        return 0;
+    }
+    printReplayResult(cursor);
+    return cursor.matches() ? 0 : 1;
+}
+
+template <int Width, int Height>
+int runGame(const FrontendOptions& options, const Replay& replay, const Snapshot& snapshot) {
+    if (!options.replayPath.empty()) {
+        return replayMain<Width, Height>(options, replay);
+    }
+    if (options.autoplay && options.headless) {
+        return autoplayMain<Width, Height>(options, snapshot);
+    }
+
+    if (recordsResumedGame(options)) return 2;
+    TetrisGame<Width, Height> game(options);
+    if (!options.resumePath.empty() && !game.resume(snapshot)) {
+        fprintf(stderr, "cannot restore snapshot %s\n", options.resumePath.c_str());
+        return 1;
+    }
     game.run();
+    if (options.frameStats) game.stats.print(stderr);
+    if (!game.recordSaved) {
+        fprintf(stderr, "could not write replay %s\n", options.recordPath.c_str());
+        return 1;
+    }
     return 0;
+}
+
+void printUsage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--das MS] [--arr MS] [--soft-drop-arr MS] [--legacy-keys]\n"
+            "          [--seed N] [--randomizer bag|history|uniform] [--preview N]\n"
+            "          [--record FILE] [--replay FILE [--headless]]\n"
+            "          [--autoplay [--headless] [--beam N] [--search-threads N] [--max-pieces N]]\n"
+            "          [--frame-stats] [--name NAME] [--board 10x20|15x20|32x64]\n"
+            "          [--versus human|ai] [--snapshot FILE] [--resume FILE]\n",
+            argv0);
+}
+
+int main(int argc, char** argv) {
+    FrontendOptions options;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--das" && hasValue) {
+            options.dasMs = max(0, atoi(argv[++i]));
+        } else if (arg == "--arr" && hasValue) {
+            options.arrMs = max(0, atoi(argv[++i]));
+        } else if (arg == "--soft-drop-arr" && hasValue) {
+            options.softDropArrMs = max(0, atoi(argv[++i]));
+        } else if (arg == "--legacy-keys") {
+            options.kittyKeyboard = false;
+        } else if (arg == "--record" && hasValue) {
+            options.recordPath = argv[++i];
+        } else if (arg == "--replay" && hasValue) {
+            options.replayPath = argv[++i];
+        } else if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--seed" && hasValue) {
+            options.fixedSeed = true;
+            options.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--randomizer" && hasValue) {
+            if (!parseRandomizer(argv[++i], options.randomizer)) {
+                fprintf(stderr, "unknown randomizer: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (arg == "--preview" && hasValue) {
+            options.previewDepth = atoi(argv[++i]);
+        } else if (arg == "--autoplay") {
+            options.autoplay = true;
+        } else if (arg == "--beam" && hasValue) {
+            options.beamWidth = max(1, atoi(argv[++i]));
+        } else if (arg == "--search-threads" && hasValue) {
+            options.searchThreads = atoi(argv[++i]);
+        } else if (arg == "--max-pieces" && hasValue) {
+            options.maxPieces = atoi(argv[++i]);
+        } else if (arg == "--frame-stats") {
+            options.frameStats = true;
+        } else if (arg == "--name" && hasValue) {
+            options.playerName = argv[++i];
+        } else if (arg == "--board" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &options.boardWidth, &options.boardHeight) != 2) {
+                fprintf(stderr, "board size must be WIDTHxHEIGHT: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (arg == "--snapshot" && hasValue) {
+            options.snapshotPath = argv[++i];
+        } else if (arg == "--resume" && hasValue) {
+            options.resumePath = argv[++i];
+        } else if (arg == "--versus" && hasValue) {
+            string opponent = argv[++i];
+            if (opponent != "human" && opponent != "ai") {
+                fprintf(stderr, "versus opponent must be human or ai: %s\n", argv[i]);
+                return 2;
+            }
+            options.versus = true;
+            options.versusAi = opponent == "ai";
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    // A replay holds one player's inputs
+    if (options.versus && (!options.recordPath.empty() || !options.replayPath.empty() ||
+                           options.headless)) {
+        fprintf(stderr, "--versus cannot be recorded, replayed or run headless\n");
+        return 2;
+    }
+
+    // A resumed game did not start from a seed, so there is no replay of it
+    if (!options.resumePath.empty() && (!options.recordPath.empty() ||
+                                        !options.replayPath.empty() || options.versus)) {
+        fprintf(stderr, "--resume cannot be combined with --record, --replay or --versus\n");
+        return 2;
+    }
+    if (options.snapshotPath.empty()) {
+        options.snapshotPath = options.resumePath.empty() ? SNAPSHOT_FILE : options.resumePath;
+    }
+
+    if (options.playerName.empty()) {
+        const char* user = getenv("USER");
+        options.playerName = user && *user ? user : "player";
+    }
+
+    // A recording is played on the board it was made on
+    Replay replay;
+    if (!options.replayPath.empty()) {
+        if (!replay.load(options.replayPath.c_str())) {
+            fprintf(stderr, "cannot read replay %s\n", options.replayPath.c_str());
+            return 1;
+        }
+        options.boardWidth = replay.boardWidth;
+        options.boardHeight = replay.boardHeight;
+    }
+
+    // So is a snapshot
+    Snapshot snapshot;
+    if (!options.resumePath.empty()) {
+        if (!snapshot.load(options.resumePath.c_str())) {
+            fprintf(stderr, "cannot read snapshot %s\n", options.resumePath.c_str());
+            return 1;
+        }
+        options.boardWidth = snapshot.boardWidth;
+        options.boardHeight = snapshot.boardHeight;
+    }
+
+    // Each supported size is a separate instantiation of the game
+    if (options.boardWidth == 10 && options.boardHeight == 20) {
+        return runGame<10, 20>(options, replay, snapshot);
+    }
+    if (options.boardWidth == 15 && options.boardHeight == 20) {
+        return runGame<15, 20>(options, replay, snapshot);
+    }
+    if (options.boardWidth == 32 && options.boardHeight == 64) {
+        return runGame<32, 64>(options, replay, snapshot);
+    }
+    fprintf(stderr, "unsupported board size %dx%d (10x20, 15x20 or 32x64)\n",
+            options.boardWidth, options.boardHeight);
+    return 2;
 }
\ No newline at end of file
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cstdint>
+
+#include "engine.h"
+
+// Move generation: every final placement a piece can reach from where it
+// is, found with a breadth-first search over (x, y, rotation) using the
+// engine's own moves - left, right, rotate with WALL_KICKS and one row
+// down - so tucks and kicked spins are included. A placement is any
+// reachable spot the piece can be hard dropped from; each keeps the
+// shortest input path to it.
+//
+// Collision is precomputed per rotation as one bitmask of free x positions
+// per row, and rows above the stack are crossed in a single jump, so a
+// call takes microseconds.
+//
+// Gravity and lock delay are ignored (inputs are assumed faster than the
+// piece falls). Rotations that cover the same cells (O, and the I, S and Z
+// pairs) produce a single placement.
+//
+// All storage is fixed size and reused between calls, so generate() never
+// allocates; one MoveGenerator per thread. Sized for one board size.
+
+struct Placement {
+    int8_t x{0};
+    int8_t y{0};            // landing row (top of the 4x4 shape)
+    uint8_t rotation{0};
+    uint16_t pathLength{0}; // inputs from the start, including the HardDrop
+    uint16_t state{0};      // BFS state the piece is hard dropped from
+};
+
+template <int Width, int Height>
+struct BasicMoveGenerator {
+    using Board = BasicBoard<Width, Height>;
+    using RowMask = typename Board::RowMask;
+
+    static constexpr int X_OFFSET = BLOCK_SIZE - 1;     // x can be -3
+    static constexpr int Y_OFFSET = BLOCK_SIZE;         // y can be -4
+    static constexpr int X_RANGE = Width + X_OFFSET;
+    static constexpr int Y_RANGE = Height + Y_OFFSET;
+    static constexpr int STATES = X_RANGE * Y_RANGE * 4;
+    static constexpr int ROW_STRIDE = X_RANGE * 4;
+    static constexpr int MAX_PLACEMENTS = 512;
+    static constexpr uint16_t NO_PARENT = 0xFFFF;
+    static_assert(STATES < NO_PARENT, "state index fits in 16 bits");
+
+    // Bit x + X_OFFSET per piece position, plus the walls around the board
+    using FreeMask = UintFor<(X_RANGE + BLOCK_SIZE > 32 ? 64 : 32)>;
+
+    Placement placements[MAX_PLACEMENTS];
+    int count{0};
+
+    // free[rot][y + Y_OFFSET] has bit (x + X_OFFSET) set when the piece
+    // fits there; every neighbour test in the search is one bit test
+    FreeMask free[4][Y_RANGE + 1]{};
+
+    // BFS bookkeeping; a state is visited when its stamp equals `epoch`,
+    // so nothing has to be cleared between calls
+    uint32_t visited[STATES]{};
+    uint16_t parent[STATES]{};
+    Action via[STATES]{};
+    uint16_t depth[STATES]{};   // inputs from the spawn; more than 255 on tall boards
+    uint16_t queue[STATES]{};
+    uint16_t sources[STATES]{};
+    uint16_t order[STATES]{};   // every visited state, in visit order
+    int visitCount{0};
+    uint32_t epoch{0};
+
+    // Cell-set keys of the placements found so far, for symmetry dedupe
+    uint32_t keys[MAX_PLACEMENTS]{};
+
+    static int encode(int x, int y, int rotation) {
+        return ((y + Y_OFFSET) * X_RANGE + (x + X_OFFSET)) * 4 + rotation;
+    }
+
+    static void decode(int state, int& x, int& y, int& rotation) {
+        rotation = state & 3;
+        int cell = state >> 2;
+        x = cell % X_RANGE - X_OFFSET;
+        y = cell / X_RANGE - Y_OFFSET;
+    }
+
+    bool fits(int x, int y, int rotation) const {
+        unsigned xi = static_cast<unsigned>(x + X_OFFSET);
+        return xi < X_RANGE && ((free[rotation][y + Y_OFFSET] >> xi) & 1u);
+    }
+
+    // No rotation of the piece touches the stack in row y
+    bool openRow(int y) const {
+        for (int rot = 0; rot < 4; ++rot) {
+            if (free[rot][y + Y_OFFSET] != free[rot][0]) return false;
+        }
+        return true;
+    }
+
+    // Identifies the board cells covered, independent of which rotation
+    // covers them: top row, left column and the shape's normalized masks
+    static uint32_t cellKey(int type, int rotation, int x, int y) {
+        static_assert(X_RANGE <= 64 && Y_RANGE + BLOCK_SIZE <= 1024, "cell key fields");
+        const Shape& shape = BlockTemplate::shape(type, rotation);
+        uint32_t masks = 0;
+        for (int row = shape.minRow; row <= shape.maxRow; ++row) {
+            uint32_t m = static_cast<uint32_t>(shape.rowMasks[row]) >> shape.minCol;
+            masks |= m << (4 * (row - shape.minRow));
+        }
+        uint32_t top = static_cast<uint32_t>(y + shape.minRow + Y_OFFSET);
+        uint32_t left = static_cast<uint32_t>(x + shape.minCol + X_OFFSET);
+        return (top << 22) | (left << 16) | masks;
+    }
+
+    static bool symmetric(int type) {
+        constexpr uint32_t MASKS = 0xFFFF;
+        return (cellKey(type, 0, 0, 0) & MASKS) == (cellKey(type, 2, 0, 0) & MASKS);
+    }
+
+    // Collision for every x at once. A board row is widened with its walls
+    // so that bit (x + X_OFFSET + b) is the cell under piece column b; the
+    // positions a piece row blocks are that row shifted right by each of
+    // the row's columns.
+    void buildFreeMasks(const RowMask rows[Height], int type) {
+        constexpr FreeMask ALL = ~FreeMask{0};
+        constexpr FreeMask X_MASK = (FreeMask{1} << X_RANGE) - 1;
+        constexpr FreeMask WALLS = ((FreeMask{1} << X_OFFSET) - 1) | (ALL << (Width + X_OFFSET));
+
+        FreeMask wide[Y_RANGE + BLOCK_SIZE + 1];
+        for (int yi = 0; yi < Y_RANGE + BLOCK_SIZE + 1; ++yi) {
+            int y = yi - Y_OFFSET;
+            if (y < 0) {
+                wide[yi] = WALLS;
+            } else if (y < Height) {
+                wide[yi] = WALLS | (static_cast<FreeMask>(rows[y]) << X_OFFSET);
+            } else {
+                wide[yi] = ALL;     // floor
+            }
+        }
+
+        for (int rot = 0; rot < 4; ++rot) {
+            const PieceMask* masks = BlockTemplate::rowMasks(type, rot);
+            for (int yi = 0; yi <= Y_RANGE; ++yi) {
+                FreeMask blocked = 0;
+#pragma GCC unroll 4
+                for (int i = 0; i < BLOCK_SIZE; ++i) {
+                    for (uint32_t m = masks[i]; m; m &= m - 1) {
+                        blocked |= wide[yi + i] >> __builtin_ctz(m);
+                    }
+                }
+                free[rot][yi] = ~blocked & X_MASK;
+            }
+        }
+    }
+
+    // Fill placements[] for `piece` on `board`; returns the count (0 when
+    // the piece itself collides)
+    int generate(const Board& board, const Piece& piece) {
+        return generate(board.rows, piece);
+    }
+
+    // Same, on bare occupancy rows (search boards have no color plane)
+    int generate(const RowMask rows[Height], const Piece& piece) {
+        count = 0;
+        if (piece.pos.y < -Y_OFFSET || piece.pos.y >= Height) return 0;
+
+        buildFreeMasks(rows, piece.type);
+        if (!fits(piece.pos.x, piece.pos.y, piece.rotation)) return 0;
+        if (++epoch == 0) {
+            // Stamp wrapped around: reset so stale stamps cannot match
+            for (uint32_t& v : visited) v = 0;
+            epoch = 1;
+        }
+
+        int head = 0, tail = 0;
+        visitCount = 0;
+        int start = encode(piece.pos.x, piece.pos.y, piece.rotation);
+        mark(start, NO_PARENT, Action::None, 0);
+        queue[tail++] = static_cast<uint16_t>(start);
+
+        // Rows the stack does not reach behave the same at every height, so
+        // when the piece starts in them only its own row is searched; each
+        // state found there then drops straight to the last open row.
+        int openBottom = piece.pos.y;
+        while (openBottom + 1 < Height && openRow(openBottom + 1)) ++openBottom;
+        int drop = openRow(piece.pos.y) ? openBottom - piece.pos.y : 0;
+        if (drop < 2) drop = 0;
+
+        int sourceHead = 0, sourceCount = 0;
+        if (drop > 0) {
+            while (head < tail) expand(tail, queue[head++], false);
+            for (int i = 0; i < tail; ++i) sources[sourceCount++] = queue[i];
+            head = tail = 0;
+        }
+
+        // Breadth first. Dropped states cost `drop` Downs more than their
+        // source, so they are merged in by depth (sources[] is already in
+        // depth order); on a tie they go first.
+        while (head < tail || sourceHead < sourceCount) {
+            if (sourceHead < sourceCount &&
+                (head == tail || depth[sources[sourceHead]] + drop <= depth[queue[head]])) {
+                int from = sources[sourceHead++];
+                int state = from + drop * ROW_STRIDE;
+                if (visited[state] == epoch) continue;
+                mark(state, from, Action::Down, depth[from] + drop);
+                expand(tail, state, true);
+            } else {
+                expand(tail, queue[head++], true);
+            }
+        }
+
+        // Every resting state the search reached is a placement. Its
+        // shortest path hard drops from the shallowest-depth state of the
+        // visited column straight above it, which continues in the start
+        // row when the column reaches the open rows.
+        for (int i = 0; i < visitCount; ++i) {
+            int state = order[i];
+            int x, y, rot;
+            decode(state, x, y, rot);
+            if (fits(x, y + 1, rot)) continue;
+
+            int from = state;
+            for (int s = state;;) {
+                if (depth[s] < depth[from]) from = s;
+                if (s >= ROW_STRIDE && visited[s - ROW_STRIDE] == epoch) {
+                    s -= ROW_STRIDE;
+                } else if (drop > 0 && s / ROW_STRIDE == openBottom + Y_OFFSET &&
+                           visited[s - drop * ROW_STRIDE] == epoch) {
+                    s -= drop * ROW_STRIDE;     // up through the open rows
+                } else {
+                    break;
+                }
+            }
+            addPlacement(piece.type, state, from);
+        }
+        return count;
+    }
+
+    void mark(int state, int from, Action action, int stateDepth) {
+        visited[state] = epoch;
+        parent[state] = static_cast<uint16_t>(from);
+        via[state] = action;
+        depth[state] = static_cast<uint16_t>(stateDepth);
+        order[visitCount++] = static_cast<uint16_t>(state);
+    }
+
+    void visit(int& tail, int from, int to, Action action) {
+        if (visited[to] == epoch) return;
+        mark(to, from, action, depth[from] + 1);
+        queue[tail++] = static_cast<uint16_t>(to);
+    }
+
+    // Queue the neighbours of `state`: the engine's moves, in step() terms
+    void expand(int& tail, int state, bool down) {
+        int x, y, rot;
+        decode(state, x, y, rot);
+        if (fits(x - 1, y, rot)) visit(tail, state, state - 4, Action::MoveLeft);
+        if (fits(x + 1, y, rot)) visit(tail, state, state + 4, Action::MoveRight);
+        if (down && fits(x, y + 1, rot)) visit(tail, state, state + ROW_STRIDE, Action::Down);
+
+        int newRot = (rot + 1) % 4;
+        for (int dx : WALL_KICKS) {
+            if (fits(x + dx, y, newRot)) {
+                visit(tail, state, encode(x + dx, y, newRot), Action::Rotate);
+                break;
+            }
+        }
+    }
+
+    // Symmetric rotations give the same cells; keep the shorter path
+    void addPlacement(int type, int resting, int dropFrom) {
+        int x, y, rot;
+        decode(resting, x, y, rot);
+        uint32_t key = cellKey(type, rot, x, y);
+        uint16_t length = static_cast<uint16_t>(depth[dropFrom] + 1);
+
+        // T, J and L never cover the same cells twice
+        for (int i = symmetric(type) ? 0 : count; i < count; ++i) {
+            if (keys[i] != key) continue;
+            if (length < placements[i].pathLength) {
+                placements[i] = makePlacement(x, y, rot, length, dropFrom);
+            }
+            return;
+        }
+        if (count == MAX_PLACEMENTS) return;
+
+        placements[count] = makePlacement(x, y, rot, length, dropFrom);
+        keys[count] = key;
+        ++count;
+    }
+
+    static Placement makePlacement(int x, int y, int rot, uint16_t length, int state) {
+        Placement p;
+        p.x = static_cast<int8_t>(x);
+        p.y = static_cast<int8_t>(y);
+        p.rotation = static_cast<uint8_t>(rot);
+        p.pathLength = length;
+        p.state = static_cast<uint16_t>(state);
+        return p;
+    }
+
+    // Inputs that take the piece from the start of the last generate() to
+    // `placement`, ending with HardDrop. Valid until the next generate().
+    // Returns the number of actions written (at most max).
+    int path(const Placement& placement, Action* out, int max) const {
+        int length = placement.pathLength;
+        if (length > max) return 0;
+
+        out[length - 1] = Action::HardDrop;
+        int i = length - 1;
+        for (int s = placement.state; parent[s] != NO_PARENT; s = parent[s]) {
+            // A dropped state stands for several Downs
+            for (int n = depth[s] - depth[parent[s]]; n > 0; --n) out[--i] = via[s];
+        }
+        return length;
+    }
+
+    // The placement as a locked piece, e.g. for Engine::lockPiece(board, ...)
+    static Piece toPiece(int type, const Placement& placement) {
+        Piece piece;
+        piece.type = type;
+        piece.rotation = placement.rotation;
+        piece.pos = Position(placement.x, placement.y);
+        return piece;
+    }
+};
+
+using MoveGenerator = BasicMoveGenerator<DEFAULT_BOARD_WIDTH, DEFAULT_BOARD_HEIGHT>;
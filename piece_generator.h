@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+
+#include "board.h"
+
+// Piece randomizers and the lookahead queue the engine spawns from. The
+// generator is a plain value (no heap, no virtual calls), so an Engine can
+// still be copied for search and a seed always gives the same sequence.
+
+enum class Randomizer : uint8_t {
+    Uniform,    // independent draws, any piece any time
+    Bag7,       // each piece once per shuffled bag of seven
+    History,    // reroll pieces found in the last four (TGM style)
+};
+
+constexpr const char* RANDOMIZER_NAMES[] = {"uniform", "bag", "history"};
+
+// Parse a --randomizer value; returns false for unknown names
+inline bool parseRandomizer(const char* name, Randomizer& out) {
+    for (int i = 0; i < 3; ++i) {
+        if (std::strcmp(name, RANDOMIZER_NAMES[i]) == 0) {
+            out = static_cast<Randomizer>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// mt19937 that remembers its seed and counts its draws, so its position in
+// the stream fits in 12 bytes instead of the 2.5 KB engine state: restoring
+// is a reseed and a discard(). The draws themselves are mt19937's.
+struct PieceRng {
+    using result_type = std::mt19937::result_type;
+
+    std::mt19937 engine;
+    uint32_t seedValue{std::mt19937::default_seed};
+    uint64_t draws{0};
+
+    static constexpr result_type min() {
+        return std::mt19937::min();
+    }
+
+    static constexpr result_type max() {
+        return std::mt19937::max();
+    }
+
+    result_type operator()() {
+        ++draws;
+        return engine();
+    }
+
+    void seed(uint32_t value) {
+        restore(value, 0);
+    }
+
+    // Back to `count` draws after seeding with value
+    void restore(uint32_t value, uint64_t count) {
+        engine.seed(value);
+        engine.discard(count);
+        seedValue = value;
+        draws = count;
+    }
+};
+
+struct PieceGenerator {
+    static constexpr int HISTORY_SIZE = 4;
+    static constexpr int HISTORY_ROLLS = 6;
+
+    Randomizer kind{Randomizer::Bag7};
+    PieceRng rng;
+
+    uint8_t bag[NUM_BLOCK_TYPES]{};
+    int bagLeft{0};                     // pieces not yet dealt from bag
+    uint8_t history[HISTORY_SIZE]{};
+    bool firstPiece{true};
+
+    void seed(uint32_t value) {
+        rng.seed(value);
+    }
+
+    // Forget bag and history; the RNG keeps its stream
+    void reset() {
+        bagLeft = 0;
+        // Piece indices: I O T S Z J L. History starts full of S and Z,
+        // which makes them unlikely openers.
+        history[0] = history[2] = 3;
+        history[1] = history[3] = 4;
+        firstPiece = true;
+    }
+
+    int next() {
+        switch (kind) {
+            case Randomizer::Bag7: return nextFromBag();
+            case Randomizer::History: return nextFromHistory();
+            case Randomizer::Uniform: break;
+        }
+        return roll();
+    }
+
+    int roll() {
+        std::uniform_int_distribution<int> dist(0, NUM_BLOCK_TYPES - 1);
+        return dist(rng);
+    }
+
+    int nextFromBag() {
+        if (bagLeft == 0) {
+            for (int i = 0; i < NUM_BLOCK_TYPES; ++i) bag[i] = static_cast<uint8_t>(i);
+            bagLeft = NUM_BLOCK_TYPES;
+        }
+        // Deal a random piece from what is left (an incremental shuffle)
+        std::uniform_int_distribution<int> dist(0, bagLeft - 1);
+        int pick = dist(rng);
+        uint8_t type = bag[pick];
+        bag[pick] = bag[--bagLeft];
+        bag[bagLeft] = type;
+        return type;
+    }
+
+    int nextFromHistory() {
+        int type = roll();
+        for (int attempt = 1; attempt < HISTORY_ROLLS && inHistory(type); ++attempt) {
+            type = roll();
+        }
+        // Never open with S, Z or O
+        if (firstPiece) {
+            while (type == 1 || type == 3 || type == 4) type = roll();
+            firstPiece = false;
+        }
+        for (int i = HISTORY_SIZE - 1; i > 0; --i) history[i] = history[i - 1];
+        history[0] = static_cast<uint8_t>(type);
+        return type;
+    }
+
+    bool inHistory(int type) const {
+        for (uint8_t h : history) {
+            if (h == type) return true;
+        }
+        return false;
+    }
+};
+
+// Upcoming pieces, kept in a small ring buffer that is topped up to
+// `depth` pieces after every pop
+struct PieceQueue {
+    static constexpr int CAPACITY = 8;      // power of two
+    static constexpr int MAX_DEPTH = CAPACITY - 1;
+
+    PieceGenerator generator;
+    uint8_t ring[CAPACITY]{};
+    uint32_t head{0};
+    uint32_t count{0};
+    int depth{5};                           // pieces visible ahead
+
+    void reset() {
+        generator.reset();
+        head = count = 0;
+        refill();
+    }
+
+    // i = 0 is the next piece to spawn
+    int peek(int i) const {
+        return ring[(head + static_cast<uint32_t>(i)) & (CAPACITY - 1)];
+    }
+
+    int pop() {
+        int type = peek(0);
+        ++head;
+        --count;
+        refill();
+        return type;
+    }
+
+    void refill() {
+        while (count < static_cast<uint32_t>(depth)) {
+            ring[(head + count) & (CAPACITY - 1)] = static_cast<uint8_t>(generator.next());
+            ++count;
+        }
+    }
+};
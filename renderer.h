@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <csignal>
+#include <unistd.h>
+
+#include "text_buffer.h"
+
+// Differential terminal output. The renderer remembers the frame that is
+// currently on screen and, for each new frame, only emits cursor moves plus
+// the characters that changed. A full clear-and-redraw happens on the first
+// frame, after the terminal is resized and after invalidate() (used when
+// another screen such as pause or game over has been drawn over the board).
+//
+// Frames and output live in fixed buffers that are reused from frame to
+// frame, and each frame goes out in a single write() - no heap allocations
+// and no iostreams once the game is running.
+
+// Set from the SIGWINCH handler, consumed by the next encode()
+inline volatile sig_atomic_t terminalResized = 0;
+
+// One screen of text rows
+struct TextFrame {
+    static constexpr int MAX_LINES = 96;
+    static constexpr size_t LINE_CAPACITY = 256;
+    using Line = TextBuffer<LINE_CAPACITY>;
+
+    Line lines[MAX_LINES];
+    int count{0};
+
+    void resize(int lineCount) {
+        count = std::min(lineCount, MAX_LINES);
+    }
+
+    // Copies only the lines in use
+    void assign(const TextFrame& other) {
+        count = other.count;
+        for (int i = 0; i < count; ++i) {
+            lines[i].assign(other.lines[i]);
+        }
+    }
+};
+
+struct TerminalRenderer {
+    // Unchanged cells shorter than this between two changes are re-sent
+    // rather than paying for another cursor move
+    static constexpr size_t MERGE_GAP = 4;
+
+    // Holds a full redraw of the largest frame
+    static constexpr size_t OUTPUT_CAPACITY = 32768;
+    using Output = TextBuffer<OUTPUT_CAPACITY>;
+
+    TextFrame presented;        // frame currently on screen
+    Output out;                 // terminal output for the last frame
+    bool fullRedraw{true};
+    int fd{STDOUT_FILENO};
+
+    static void onResize(int) {
+        terminalResized = 1;
+    }
+
+    static void installResizeHandler() {
+        struct sigaction sa{};
+        sa.sa_handler = onResize;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGWINCH, &sa, nullptr);
+    }
+
+    // Next present() repaints everything
+    void invalidate() {
+        fullRedraw = true;
+    }
+
+    void present(const TextFrame& frame) {
+        encode(frame);
+        flush();
+    }
+
+    // Replaces out with the terminal output that turns the presented frame
+    // into this one (empty if nothing changed), and remembers it as presented
+    void encode(const TextFrame& frame) {
+        if (terminalResized) {
+            terminalResized = 0;
+            fullRedraw = true;
+        }
+        out.clear();
+
+        if (!fullRedraw) {
+            for (int row = 0; row < frame.count; ++row) {
+                if (row < presented.count) {
+                    diffLine(out, row, presented.lines[row], frame.lines[row]);
+                } else {
+                    moveTo(out, row, 0);
+                    out.append(frame.lines[row], 0, frame.lines[row].size);
+                    out.append("\033[K");
+                }
+            }
+
+            // Erase rows the new frame no longer covers
+            for (int row = frame.count; row < presented.count; ++row) {
+                moveTo(out, row, 0);
+                out.append("\033[K");
+            }
+
+            if (out.empty()) {
+                presented.assign(frame);
+                return;
+            }
+
+            // Park the cursor below the frame, where a full redraw leaves it
+            moveTo(out, frame.count, 0);
+
+            // Scattered changes can cost more than the screen itself
+            if (out.truncated) {
+                out.clear();
+                fullRedraw = true;
+            }
+        }
+
+        if (fullRedraw) {
+            // Clear screen + move cursor to top-left
+            out.append("\033[2J\033[1;1H");
+            for (int row = 0; row < frame.count; ++row) {
+                out.append(frame.lines[row], 0, frame.lines[row].size);
+                out.append('\n');
+            }
+            fullRedraw = false;
+        }
+
+        presented.assign(frame);
+    }
+
+    // Sends the encoded frame in a single output call
+    void flush() {
+        if (out.empty()) return;
+        if (!out.writeTo(fd)) fullRedraw = true;
+    }
+
+    static void moveTo(Output& out, size_t row, size_t col) {
+        out.append("\033[");
+        out.appendInt(static_cast<long>(row + 1));
+        out.append(';');
+        out.appendInt(static_cast<long>(col + 1));
+        out.append('H');
+    }
+
+    static bool isAscii(const TextFrame::Line& line) {
+        for (size_t i = 0; i < line.size; ++i) {
+            if (static_cast<unsigned char>(line[i]) >= 0x80) return false;
+        }
+        return true;
+    }
+
+    static void diffLine(Output& out, size_t row,
+                         const TextFrame::Line& before, const TextFrame::Line& after) {
+        if (before == after) return;
+
+        // Byte offsets are not columns once multi-byte characters are
+        // involved, so such lines are rewritten whole
+        if (!isAscii(before) || !isAscii(after)) {
+            moveTo(out, row, 0);
+            out.append(after, 0, after.size);
+            out.append("\033[K");
+            return;
+        }
+
+        size_t common = std::min(before.size, after.size);
+        size_t col = 0;
+        while (col < common) {
+            if (before[col] == after[col]) {
+                ++col;
+                continue;
+            }
+
+            // Extend the run over changes separated by short unchanged gaps
+            size_t end = col + 1;
+            size_t gap = 0;
+            for (size_t k = end; k < common && gap < MERGE_GAP; ++k) {
+                if (before[k] != after[k]) {
+                    end = k + 1;
+                    gap = 0;
+                } else {
+                    ++gap;
+                }
+            }
+
+            moveTo(out, row, col);
+            out.append(after, col, end - col);
+            col = end;
+        }
+
+        if (after.size > common) {
+            moveTo(out, row, common);
+            out.append(after, common, after.size - common);
+        } else if (before.size > common) {
+            moveTo(out, row, common);
+            out.append("\033[K");
+        }
+    }
+};
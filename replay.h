@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "engine.h"
+
+// Deterministic game recordings. The engine is a pure function of its seed
+// and the calls made on it, so a game is fully described by the seed plus
+// every step() action tagged with the number of tick()s that preceded it.
+// Ticks are always tick(Action::None, false) in the frontend.
+//
+// File layout (little endian):
+//   "TRPL" version:u8 randomizer:u8 width:u8 height:u8 seed:u32 ticks:u32
+//   score:u32 lines:u32 level:u32 count:u32, then count events, each a
+//   varint of (tickDelta << 3) | action. Version 1 files have no randomizer
+//   byte and always used the uniform randomizer; versions 1 and 2 have no
+//   board size and were played on the default board.
+// Action values are stored as-is, so the Action enum must stay append-only.
+
+struct ReplayEvent {
+    uint32_t tick{0};       // tick() calls made before this step()
+    Action action{Action::None};
+};
+
+struct Replay {
+    static constexpr char MAGIC[4] = {'T', 'R', 'P', 'L'};
+    static constexpr uint8_t VERSION = 3;
+    static constexpr int ACTION_BITS = 3;
+
+    uint32_t seed{0};
+    Randomizer randomizer{Randomizer::Uniform};
+    int boardWidth{DEFAULT_BOARD_WIDTH};
+    int boardHeight{DEFAULT_BOARD_HEIGHT};
+    std::vector<ReplayEvent> events;
+
+    // Filled in by finish(); playback stops after totalTicks
+    uint32_t totalTicks{0};
+    GameState result;
+
+    void start(uint32_t gameSeed, Randomizer kind, int width, int height) {
+        seed = gameSeed;
+        randomizer = kind;
+        boardWidth = width;
+        boardHeight = height;
+        events.clear();
+        totalTicks = 0;
+        result = GameState{};
+    }
+
+    void record(uint32_t tick, Action action) {
+        if (action != Action::None) events.push_back({tick, action});
+    }
+
+    void finish(uint32_t ticks, const GameState& state) {
+        totalTicks = ticks;
+        result = state;
+    }
+
+    // ---------- file format ----------
+
+    bool save(const char* path) const {
+        std::vector<uint8_t> out;
+        out.reserve(32 + events.size() * 2);
+        out.insert(out.end(), MAGIC, MAGIC + 4);
+        out.push_back(VERSION);
+        out.push_back(static_cast<uint8_t>(randomizer));
+        out.push_back(static_cast<uint8_t>(boardWidth));
+        out.push_back(static_cast<uint8_t>(boardHeight));
+        putU32(out, seed);
+        putU32(out, totalTicks);
+        putU32(out, static_cast<uint32_t>(result.score));
+        putU32(out, static_cast<uint32_t>(result.linesCleared));
+        putU32(out, static_cast<uint32_t>(result.level));
+        putU32(out, static_cast<uint32_t>(events.size()));
+
+        uint32_t lastTick = 0;
+        for (const ReplayEvent& event : events) {
+            uint64_t packed = (static_cast<uint64_t>(event.tick - lastTick) << ACTION_BITS) |
+                              static_cast<uint8_t>(event.action);
+            putVarint(out, packed);
+            lastTick = event.tick;
+        }
+
+        FILE* file = std::fopen(path, "wb");
+        if (!file) return false;
+        bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    // Returns false for a missing, truncated or foreign file
+    bool load(const char* path) {
+        std::vector<uint8_t> in;
+        FILE* file = std::fopen(path, "rb");
+        if (!file) return false;
+        uint8_t chunk[4096];
+        size_t n;
+        while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+            in.insert(in.end(), chunk, chunk + n);
+        }
+        std::fclose(file);
+
+        if (in.size() < 5 || in[0] != MAGIC[0] || in[1] != MAGIC[1] ||
+            in[2] != MAGIC[2] || in[3] != MAGIC[3] || in[4] < 1 || in[4] > VERSION) {
+            return false;
+        }
+        size_t pos = 5;
+        randomizer = Randomizer::Uniform;
+        if (in[4] >= 2) {
+            if (in.size() < 6 || in[5] > static_cast<uint8_t>(Randomizer::History)) return false;
+            randomizer = static_cast<Randomizer>(in[pos++]);
+        }
+        boardWidth = DEFAULT_BOARD_WIDTH;
+        boardHeight = DEFAULT_BOARD_HEIGHT;
+        if (in[4] >= 3) {
+            if (in.size() < pos + 2) return false;
+            boardWidth = in[pos++];
+            boardHeight = in[pos++];
+        }
+        if (in.size() < pos + 24) return false;
+        uint32_t score = 0, lines = 0, level = 0, count = 0;
+        seed = getU32(in, pos);
+        totalTicks = getU32(in, pos);
+        score = getU32(in, pos);
+        lines = getU32(in, pos);
+        level = getU32(in, pos);
+        count = getU32(in, pos);
+
+        result = GameState{};
+        result.score = static_cast<int>(score);
+        result.linesCleared = static_cast<int>(lines);
+        result.level = static_cast<int>(level);
+
+        events.clear();
+        events.reserve(count < in.size() ? count : in.size());
+        uint32_t tick = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint64_t packed = 0;
+            if (!getVarint(in, pos, packed)) return false;
+            uint8_t action = static_cast<uint8_t>(packed & ((1u << ACTION_BITS) - 1));
+            if (action > static_cast<uint8_t>(Action::HardDrop)) return false;
+            tick += static_cast<uint32_t>(packed >> ACTION_BITS);
+            events.push_back({tick, static_cast<Action>(action)});
+        }
+        return pos == in.size();
+    }
+
+    static void putU32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    static uint32_t getU32(const std::vector<uint8_t>& in, size_t& pos) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(in[pos++]) << (8 * i);
+        }
+        return value;
+    }
+
+    static void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static bool getVarint(const std::vector<uint8_t>& in, size_t& pos, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= in.size()) return false;
+            uint8_t byte = in[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+};
+
+// Steps through a recording on an engine of the recording's board size.
+// Callers either run it to the end at full speed (runToEnd) or interleave
+// stepTick() with their own clock.
+template <typename GameEngine>
+struct ReplayCursor {
+    const Replay& replay;
+    GameEngine& engine;
+    size_t nextEvent{0};
+    uint32_t ticks{0};
+
+    ReplayCursor(const Replay& r, GameEngine& e) : replay(r), engine(e) {
+        engine.configure(replay.randomizer, engine.queue.depth);
+        engine.seed(replay.seed);
+        engine.reset();
+    }
+
+    bool done() const {
+        return ticks >= replay.totalTicks || !engine.state.running;
+    }
+
+    // Apply the actions recorded before the next tick, then tick unless the
+    // recording ends here. Returns the combined result.
+    StepResult stepTick() {
+        StepResult result;
+        while (nextEvent < replay.events.size() && replay.events[nextEvent].tick <= ticks) {
+            merge(result, engine.step(replay.events[nextEvent++].action));
+        }
+        if (!done()) {
+            merge(result, engine.tick(Action::None, false));
+            ++ticks;
+        }
+        return result;
+    }
+
+    void runToEnd() {
+        while (!done()) stepTick();
+        // Inputs recorded after the last tick (e.g. the final hard drop)
+        stepTick();
+    }
+
+    // The engine reached the state that was recorded
+    bool matches() const {
+        return engine.state.score == replay.result.score &&
+               engine.state.linesCleared == replay.result.linesCleared &&
+               engine.state.level == replay.result.level;
+    }
+
+    static void merge(StepResult& into, const StepResult& step) {
+        into.moved |= step.moved;
+        into.locked |= step.locked;
+        into.linesCleared += step.linesCleared;
+        into.gameOver |= step.gameOver;
+    }
+};
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "file_io.h"
+
+// High score table shared by every game on the machine that uses the same
+// file. Updates are serialized with flock() on a lock file next to the
+// table (the table itself is replaced on every write, so it cannot carry
+// the lock), read-modify-written under that lock, and replaced with
+// replaceFile() (temporary file, fsync, rename). Readers
+// therefore see either the old table or the new one, never a torn file,
+// and two games finishing at once both get their score in.
+//
+// File format, little-endian: "TSCO", version byte, record count (u8),
+// then fixed 40-byte records, best first. A table that is read but does
+// not decode (truncated, corrupt, another program's file) is moved aside
+// to <path>.bad by the next add(), which starts over from the legacy
+// scores, so one bad file does not stop every later score being saved.
+
+struct ScoreRecord {
+    static constexpr int NAME_LENGTH = 16;
+
+    char name[NAME_LENGTH]{};   // NUL-padded, not necessarily terminated
+    int32_t score{0};
+    int32_t lines{0};
+    int32_t level{0};
+    uint32_t durationMs{0};     // game time, pauses excluded
+    int64_t timestamp{0};       // unix seconds when the game ended
+
+    void setName(const char* text) {
+        std::memset(name, 0, sizeof(name));
+        std::memcpy(name, text, strnlen(text, sizeof(name)));
+    }
+
+    std::string nameString() const {
+        return std::string(name, strnlen(name, sizeof(name)));
+    }
+};
+
+// Best CAPACITY records, best first. Equal scores keep the order they were
+// added in and share the better rank.
+struct TopScores {
+    static constexpr int CAPACITY = 10;
+
+    ScoreRecord records[CAPACITY];
+    int count{0};
+
+    // 1-based rank a score has (or would have) in the table; CAPACITY + 1
+    // or more when it is off the table
+    int rankOf(int32_t score) const {
+        auto better = [](const ScoreRecord& r, int32_t s) { return r.score > s; };
+        return static_cast<int>(std::lower_bound(records, records + count, score, better) - records) + 1;
+    }
+
+    // Inserts the record unless it is off the table; returns its rank
+    int insert(const ScoreRecord& record) {
+        auto notWorse = [](int32_t s, const ScoreRecord& r) { return s > r.score; };
+        int at = static_cast<int>(std::upper_bound(records, records + count, record.score, notWorse) - records);
+        int rank = rankOf(record.score);
+        if (at >= CAPACITY) return rank;
+
+        int moved = std::min(count, CAPACITY - 1) - at;
+        std::memmove(records + at + 1, records + at, moved * sizeof(ScoreRecord));
+        records[at] = record;
+        count = std::min(count + 1, CAPACITY);
+        return rank;
+    }
+};
+
+struct ScoreStore {
+    static constexpr char MAGIC[4] = {'T', 'S', 'C', 'O'};
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 6;
+    static constexpr size_t RECORD_SIZE = ScoreRecord::NAME_LENGTH + 24;
+
+    std::string path;
+    std::string legacyPath;     // old text table (one score per line), read once
+    bool setAside{false};       // the last add() moved an undecodable table to badPath()
+
+    explicit ScoreStore(std::string tablePath, std::string oldTextPath = "")
+        : path(std::move(tablePath)), legacyPath(std::move(oldTextPath)) {}
+
+    // Current table; false when it cannot be read (a missing file is an
+    // empty table). *corrupt tells a file that was read but does not decode.
+    bool load(TopScores& table, bool* corrupt = nullptr) const {
+        table = TopScores{};
+        if (corrupt) *corrupt = false;
+        std::vector<uint8_t> in;
+        if (!readFile(path, in)) {
+            if (errno != ENOENT) return false;
+            loadLegacy(table);
+            return true;
+        }
+        if (decode(in, table)) return true;
+        if (corrupt) *corrupt = true;
+        return false;
+    }
+
+    std::string badPath() const {
+        return path + ".bad";
+    }
+
+    // Adds a finished game under the lock and returns its rank in `rank`.
+    // An undecodable table is moved to badPath() and replaced (setAside).
+    // On failure the rank is still computed against the table as read, and
+    // the table on disk is left as it was.
+    bool add(const ScoreRecord& record, int& rank) {
+        int lockFd = ::open((path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lockFd < 0) {
+            TopScores table;
+            load(table);
+            rank = table.rankOf(record.score);
+            return false;
+        }
+        while (flock(lockFd, LOCK_EX) != 0 && errno == EINTR) {
+        }
+
+        TopScores table;
+        bool corrupt = false;
+        bool ok = load(table, &corrupt);
+        setAside = false;
+        if (corrupt && ::rename(path.c_str(), badPath().c_str()) == 0) {
+            // Keep the bad file for inspection and start over
+            setAside = true;
+            table = TopScores{};
+            loadLegacy(table);
+            ok = true;
+        }
+        rank = table.insert(record);
+        if (ok && (rank <= TopScores::CAPACITY || setAside)) {
+            ok = save(table);
+        }
+
+        flock(lockFd, LOCK_UN);
+        ::close(lockFd);
+        return ok;
+    }
+
+    // ---------- file format ----------
+
+    static void encode(const TopScores& table, std::vector<uint8_t>& out) {
+        out.clear();
+        out.insert(out.end(), MAGIC, MAGIC + 4);
+        out.push_back(VERSION);
+        out.push_back(static_cast<uint8_t>(table.count));
+        for (int i = 0; i < table.count; ++i) {
+            const ScoreRecord& r = table.records[i];
+            out.insert(out.end(), r.name, r.name + ScoreRecord::NAME_LENGTH);
+            putU32(out, static_cast<uint32_t>(r.score));
+            putU32(out, static_cast<uint32_t>(r.lines));
+            putU32(out, static_cast<uint32_t>(r.level));
+            putU32(out, r.durationMs);
+            putU32(out, static_cast<uint32_t>(static_cast<uint64_t>(r.timestamp)));
+            putU32(out, static_cast<uint32_t>(static_cast<uint64_t>(r.timestamp) >> 32));
+        }
+    }
+
+    // Returns false for a truncated or foreign file
+    static bool decode(const std::vector<uint8_t>& in, TopScores& table) {
+        if (in.size() < HEADER_SIZE || std::memcmp(in.data(), MAGIC, 4) != 0 ||
+            in[4] != VERSION || in[5] > TopScores::CAPACITY ||
+            in.size() != HEADER_SIZE + in[5] * RECORD_SIZE) {
+            return false;
+        }
+
+        size_t pos = HEADER_SIZE;
+        table.count = in[5];
+        for (int i = 0; i < table.count; ++i) {
+            ScoreRecord& r = table.records[i];
+            std::memcpy(r.name, in.data() + pos, ScoreRecord::NAME_LENGTH);
+            pos += ScoreRecord::NAME_LENGTH;
+            r.score = static_cast<int32_t>(getU32(in, pos));
+            r.lines = static_cast<int32_t>(getU32(in, pos));
+            r.level = static_cast<int32_t>(getU32(in, pos));
+            r.durationMs = getU32(in, pos);
+            uint64_t low = getU32(in, pos);
+            uint64_t high = getU32(in, pos);
+            r.timestamp = static_cast<int64_t>(low | (high << 32));
+        }
+        return true;
+    }
+
+    static void putU32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    static uint32_t getU32(const std::vector<uint8_t>& in, size_t& pos) {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(in[pos++]) << (8 * i);
+        }
+        return value;
+    }
+
+    // ---------- files ----------
+
+    // Only called with the lock held, so one temporary name is enough
+    bool save(const TopScores& table) const {
+        std::vector<uint8_t> out;
+        encode(table, out);
+        return replaceFile(path, out);
+    }
+
+    // Scores from the old text table, if there is one, with no other details
+    void loadLegacy(TopScores& table) const {
+        if (legacyPath.empty()) return;
+        FILE* file = std::fopen(legacyPath.c_str(), "r");
+        if (!file) return;
+        int score;
+        while (std::fscanf(file, "%d", &score) == 1) {
+            ScoreRecord record;
+            record.setName("-");
+            record.score = score;
+            table.insert(record);
+        }
+        std::fclose(file);
+    }
+};
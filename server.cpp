@@ -0,0 +1,93 @@
+// tetris-server: hosts many games in one process on a Unix domain socket.
+// Each connection is a terminal playing its own game; connect with e.g.
+//   socat -,icanon=0,echo=0 UNIX-CONNECT:tetris.sock
+// and watch game 3 on tetris-watch.sock by typing 3 and Enter.
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <pthread.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+#include "server.h"
+
+using namespace std;
+
+// SIGINT and SIGTERM are blocked in every thread - the reactors inherit
+// the mask, so call this before starting them - and read from the
+// returned signalfd in the accept loop instead. Whichever thread the
+// kernel would have picked, shutdown wakes the accept loop's poll().
+int blockStopSignals() {
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    if (pthread_sigmask(SIG_BLOCK, &stop, nullptr) != 0) return -1;
+    return signalfd(-1, &stop, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+void printUsage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--socket PATH] [--watch-socket PATH] [--threads N] [--seed N]\n"
+            "          [--randomizer bag|history|uniform] [--preview N]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    ServerConfig config;
+    bool fixedSeed = false;
+    uint32_t seed = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue) {
+            config.socketPath = argv[++i];
+        } else if (arg == "--watch-socket" && hasValue) {
+            config.watchPath = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            config.threads = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            fixedSeed = true;
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--randomizer" && hasValue) {
+            if (!parseRandomizer(argv[++i], config.randomizer)) {
+                fprintf(stderr, "unknown randomizer: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (arg == "--preview" && hasValue) {
+            config.previewDepth = atoi(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    int stopFd = blockStopSignals();
+    if (stopFd < 0) {
+        fprintf(stderr, "cannot set up signal handling: %s\n", strerror(errno));
+        return 1;
+    }
+
+    GameServer server(config);
+    if (!server.listen()) {
+        fprintf(stderr, "cannot listen on %s or %s: %s\n", config.socketPath.c_str(),
+                config.watchPath.c_str(), strerror(errno));
+        return 1;
+    }
+    fprintf(stderr, "tetris-server: %s, spectators on %s, %zu reactor threads\n",
+            config.socketPath.c_str(), config.watchPath.c_str(), server.reactors.size());
+
+    // One fresh engine seed per game; --seed makes the sequence repeat
+    mt19937 seeder(fixedSeed ? seed : random_device{}());
+    server.serve(stopFd, seeder);
+    close(stopFd);
+
+    fprintf(stderr, "tetris-server: shutting down, %d games open\n", server.sessionCount());
+    server.shutdown();
+    return 0;
+}
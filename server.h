@@ -0,0 +1,532 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "broadcast.h"
+#include "event_loop.h"
+#include "session.h"
+
+// Many games in one process. The accepting thread hands each connection to
+// one of a few reactor threads, round robin; a reactor owns its sessions
+// for their whole life, so sessions need no locks. Each reactor sleeps in
+// epoll_wait() on its sessions' sockets, a wake-up eventfd for new
+// connections and one periodic timerfd that drives the logic ticks of all
+// its games at once - no thread and no sleep loop per player.
+//
+// Spectators connect to a second socket and type the number of the game
+// to watch. Game n always lives on reactor (n - 1) % threads, so a
+// spectator is handed to that reactor and served by the same thread as
+// the game it watches.
+
+struct ServerConfig {
+    std::string socketPath{"tetris.sock"};
+    std::string watchPath{"tetris-watch.sock"};     // spectators
+    int threads{0};             // reactor threads, 0 = one per hardware thread
+    Randomizer randomizer{Randomizer::Bag7};
+    int previewDepth{5};
+};
+
+inline size_t reactorForGame(int gameId, size_t reactorCount) {
+    return static_cast<size_t>(gameId - 1) % reactorCount;
+}
+
+// A spectator's connection: in the lobby typing a game number, or watching
+struct Spectator {
+    Viewer viewer;
+    GameSession* game{nullptr};     // null in the lobby
+    std::string typed;              // game number typed so far
+};
+
+struct Reactor {
+    static constexpr int MAX_EVENTS = 64;
+    static constexpr uint64_t TIMER_TAG = ~uint64_t{0};
+    static constexpr uint64_t WAKE_TAG = ~uint64_t{0} - 1;
+
+    const ServerConfig& config;
+    int epollFd{-1};
+    int timerFd{-1};
+    int wakeFd{-1};             // eventfd: new connections or shutdown
+    bool timerArmed{false};
+    FixedTimestep logic;
+
+    // A new player, or a spectator (gameId 0 = to the lobby)
+    struct Connection {
+        int fd;
+        bool spectator;
+        int gameId;
+        uint32_t seed;
+    };
+
+    // Filled by the accepting thread and other reactors, drained by this one
+    std::mutex lock;
+    std::vector<Connection> incoming;
+    bool stopping{false};
+
+    std::unordered_map<int, std::unique_ptr<GameSession>> sessions;    // by fd
+    std::unordered_map<int, std::unique_ptr<Spectator>> spectators;    // by fd
+    std::atomic<int> sessionCount{0};
+    std::vector<Reactor*> peers;    // every reactor, this one included
+    std::thread thread;
+
+    explicit Reactor(const ServerConfig& serverConfig) : config(serverConfig) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        watch(timerFd, EPOLLIN, TIMER_TAG);
+        watch(wakeFd, EPOLLIN, WAKE_TAG);
+    }
+
+    ~Reactor() {
+        for (auto& entry : sessions) ::close(entry.first);
+        for (auto& entry : spectators) ::close(entry.first);
+        for (const Connection& connection : incoming) ::close(connection.fd);
+        for (int fd : {epollFd, timerFd, wakeFd}) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    bool valid() const {
+        return epollFd >= 0 && timerFd >= 0 && wakeFd >= 0;
+    }
+
+    void watch(int fd, uint32_t events, uint64_t tag) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.u64 = tag;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    // ---------- called from other threads ----------
+
+    void add(int fd, int gameId, uint32_t seed) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            incoming.push_back({fd, false, gameId, seed});
+        }
+        ++sessionCount;
+        wake();
+    }
+
+    void addSpectator(int fd, int gameId) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            incoming.push_back({fd, true, gameId, 0});
+        }
+        wake();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake();
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t n = ::write(wakeFd, &one, sizeof(one));
+        (void)n;
+    }
+
+    // ---------- reactor thread ----------
+
+    void run() {
+        epoll_event events[MAX_EVENTS];
+        for (;;) {
+            int ready = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+            if (ready < 0 && errno != EINTR) return;
+            int64_t now = monotonicNowNs();
+
+            for (int i = 0; i < ready; ++i) {
+                uint64_t tag = events[i].data.u64;
+                if (tag == TIMER_TAG) {
+                    uint64_t expirations = 0;
+                    ssize_t n = ::read(timerFd, &expirations, sizeof(expirations));
+                    (void)n;
+                    tickAll(now);
+                } else if (tag == WAKE_TAG) {
+                    uint64_t count = 0;
+                    ssize_t n = ::read(wakeFd, &count, sizeof(count));
+                    (void)n;
+                    if (!acceptIncoming(now)) return;
+                } else {
+                    onSocket(static_cast<int>(tag), events[i].events, now);
+                }
+            }
+        }
+    }
+
+    // Starts the queued connections; false once the server is stopping
+    bool acceptIncoming(int64_t now) {
+        std::vector<Connection> added;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (stopping) return false;
+            added.swap(incoming);
+        }
+
+        for (const Connection& connection : added) {
+            int fd = connection.fd;
+            watch(fd, EPOLLIN | EPOLLRDHUP, static_cast<uint64_t>(fd));
+            if (connection.spectator) {
+                auto spectator = std::make_unique<Spectator>();
+                spectator->viewer.fd = fd;
+                Spectator& joined = *spectator;
+                spectators.emplace(fd, std::move(spectator));
+                if (connection.gameId > 0) {
+                    watchGame(joined, connection.gameId);
+                } else {
+                    prompt(fd);
+                }
+                continue;
+            }
+
+            auto session = std::make_unique<GameSession>();
+            session->start(fd, connection.gameId, connection.seed, config.randomizer,
+                           config.previewDepth);
+            GameSession& started = *session;
+            sessions.emplace(fd, std::move(session));
+            if (!present(started, now)) close(fd);
+        }
+        updateTimer(now);
+        return true;
+    }
+
+    void onSocket(int fd, uint32_t events, int64_t now) {
+        auto it = sessions.find(fd);
+        if (it == sessions.end()) {
+            auto watching = spectators.find(fd);
+            if (watching != spectators.end()) onSpectator(*watching->second, events);
+            return;
+        }
+        GameSession& session = *it->second;
+
+        bool alive = !(events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP));
+        if (alive && (events & EPOLLIN)) alive = session.onReadable(now);
+        if (alive && session.open()) alive = present(session, now);
+        if (!alive || !session.open()) close(fd);
+    }
+
+    // One logic step for every game, then the frames that changed
+    void tickAll(int64_t now) {
+        int steps = logic.due(now);
+        std::vector<int> closed;
+        for (auto& entry : sessions) {
+            GameSession& session = *entry.second;
+            session.input.expire(now);
+            for (int s = 0; s < steps; ++s) session.tick();
+            if (!present(session, now)) closed.push_back(entry.first);
+        }
+        for (int fd : closed) close(fd);
+    }
+
+    // Writes what the socket takes and asks for EPOLLOUT while a frame is
+    // only partly sent; a new frame also goes out to the spectators
+    bool present(GameSession& session, int64_t now) {
+        bool waiting = session.pendingOutput();
+        uint64_t published = session.broadcast ? session.broadcast->sequence : 0;
+        if (!session.present(now)) return false;
+        if (session.pendingOutput() != waiting) wantOutput(session.fd, session.pendingOutput());
+
+        if (session.broadcast && session.broadcast->sequence != published) {
+            std::vector<int> failed;
+            for (int fd : session.broadcast->viewers) {
+                if (!pump(*spectators[fd])) failed.push_back(fd);
+            }
+            for (int fd : failed) closeSpectator(fd, false);
+        }
+        return true;
+    }
+
+    void wantOutput(int fd, bool wanted) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | (wanted ? EPOLLOUT : 0u);
+        ev.data.u64 = static_cast<uint64_t>(fd);
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    // Best effort: short texts for the lobby, dropped if the socket is full
+    static void say(int fd, const std::string& text) {
+        ssize_t n = ::send(fd, text.data(), text.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        (void)n;
+    }
+
+    void close(int fd) {
+        auto it = sessions.find(fd);
+        if (it == sessions.end()) return;
+        if (it->second->quit) {
+            // Leave the client's terminal below the frame
+            say(fd, "\r\nbye\r\n");
+        }
+
+        // Spectators go back to the lobby
+        if (GameSession& session = *it->second; session.broadcast) {
+            std::string ended = "\r\ngame " + std::to_string(session.id) + " has ended\r\n";
+            for (int viewerFd : session.broadcast->viewers) {
+                Spectator& spectator = *spectators[viewerFd];
+                spectator.game = nullptr;
+                if (spectator.viewer.pendingOutput()) wantOutput(viewerFd, false);
+                spectator.viewer.reset();
+                say(viewerFd, ended);
+                prompt(viewerFd);
+            }
+        }
+
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        sessions.erase(it);
+        --sessionCount;
+        updateTimer(monotonicNowNs());
+    }
+
+    // The tick timer only runs while there are games
+    void updateTimer(int64_t now) {
+        bool wanted = !sessions.empty();
+        if (wanted == timerArmed) return;
+        timerArmed = wanted;
+
+        itimerspec spec{};
+        if (wanted) {
+            logic.start(LOGIC_HZ, now);
+            spec.it_value.tv_nsec = logic.stepNs;
+            spec.it_interval.tv_nsec = logic.stepNs;
+        }
+        timerfd_settime(timerFd, 0, &spec, nullptr);
+    }
+
+    // ---------- spectators ----------
+
+    static void prompt(int fd) {
+        say(fd, "\r\nGame number to watch (Q to leave): ");
+    }
+
+    // Lobby keys are digits, Backspace and Enter; Q leaves at any time
+    void onSpectator(Spectator& spectator, uint32_t events) {
+        int fd = spectator.viewer.fd;
+        if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+            closeSpectator(fd, false);
+            return;
+        }
+
+        if (events & EPOLLIN) {
+            char keys[64];
+            ssize_t n = ::recv(fd, keys, sizeof(keys), MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                closeSpectator(fd, false);
+                return;
+            }
+            for (ssize_t i = 0; i < n; ++i) {
+                char c = keys[i];
+                if (c == 'q' || c == 'Q') {
+                    closeSpectator(fd, true);
+                    return;
+                }
+                if (spectator.game) continue;
+
+                std::string& typed = spectator.typed;
+                if (c >= '0' && c <= '9' && typed.size() < 9) {
+                    typed += c;
+                    say(fd, std::string(1, c));
+                } else if ((c == '\b' || c == 127) && !typed.empty()) {
+                    typed.pop_back();
+                    say(fd, "\b \b");
+                } else if ((c == '\r' || c == '\n') && !typed.empty()) {
+                    int gameId = std::atoi(typed.c_str());
+                    typed.clear();
+                    // The rest of the input is dropped; the spectator may
+                    // not even be ours after this
+                    watchGame(spectator, gameId);
+                    return;
+                }
+            }
+        }
+
+        if (spectator.game && !pump(spectator)) closeSpectator(fd, false);
+    }
+
+    // Attaches the spectator to a game of this reactor, or hands it to the
+    // reactor the game lives on
+    void watchGame(Spectator& spectator, int gameId) {
+        int fd = spectator.viewer.fd;
+        Reactor* owner = gameId > 0 ? peers[reactorForGame(gameId, peers.size())] : this;
+        if (owner != this) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            spectators.erase(fd);
+            owner->addSpectator(fd, gameId);
+            return;
+        }
+
+        auto it = std::find_if(sessions.begin(), sessions.end(),
+                               [gameId](const auto& entry) { return entry.second->id == gameId; });
+        if (it == sessions.end()) {
+            say(fd, "\r\nno game " + std::to_string(gameId) + " is running");
+            prompt(fd);
+            return;
+        }
+
+        GameSession& game = *it->second;
+        if (!game.broadcast) game.broadcast = std::make_unique<Broadcast>();
+        game.broadcast->viewers.push_back(fd);
+        game.dirty = true;      // the viewer count, and a first frame
+        spectator.game = &game;
+        spectator.viewer.reset();
+    }
+
+    // Writes what the socket takes and asks for EPOLLOUT while a frame is
+    // only partly sent
+    bool pump(Spectator& spectator) {
+        Viewer& viewer = spectator.viewer;
+        bool waiting = viewer.pendingOutput();
+        if (!viewer.pump(*spectator.game->broadcast)) return false;
+        if (viewer.pendingOutput() != waiting) wantOutput(viewer.fd, viewer.pendingOutput());
+        return true;
+    }
+
+    void closeSpectator(int fd, bool leaving) {
+        auto it = spectators.find(fd);
+        if (it == spectators.end()) return;
+
+        // The last one out stops the game's broadcast
+        if (GameSession* game = it->second->game) {
+            std::vector<int>& viewers = game->broadcast->viewers;
+            viewers.erase(std::find(viewers.begin(), viewers.end(), fd));
+            if (viewers.empty()) game->broadcast.reset();
+            game->dirty = true;
+        }
+
+        if (leaving) say(fd, "\r\nbye\r\n");
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        spectators.erase(it);
+    }
+};
+
+struct GameServer {
+    ServerConfig config;
+    int listenFd{-1};
+    int watchFd{-1};
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    int gamesStarted{0};
+
+    explicit GameServer(ServerConfig serverConfig) : config(std::move(serverConfig)) {}
+
+    ~GameServer() {
+        shutdown();
+    }
+
+    // Binds both sockets (replacing stale ones) and starts the reactors
+    bool listen() {
+        if (!bindSocket(config.socketPath, listenFd) || !bindSocket(config.watchPath, watchFd)) {
+            return false;
+        }
+
+        int count = config.threads;
+        if (count <= 0) count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int i = 0; i < count; ++i) {
+            reactors.push_back(std::make_unique<Reactor>(config));
+            if (!reactors.back()->valid()) return false;
+        }
+        std::vector<Reactor*> peers;
+        for (auto& reactor : reactors) peers.push_back(reactor.get());
+        for (auto& reactor : reactors) {
+            reactor->peers = peers;
+            reactor->thread = std::thread(&Reactor::run, reactor.get());
+        }
+        return true;
+    }
+
+    static bool bindSocket(const std::string& path, int& fd) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return false;
+        }
+        path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return false;
+        ::unlink(path.c_str());
+        return ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+               ::listen(fd, SOMAXCONN) == 0;
+    }
+
+    // Accepts until stopFd (e.g. a signalfd) becomes readable; one seed
+    // per game from seeder. Games are numbered from 1 and spread over the
+    // reactors round robin; spectators start in the lobby on the first
+    // reactor.
+    template <typename Seeder>
+    void serve(int stopFd, Seeder& seeder) {
+        pollfd listening[3] = {{listenFd, POLLIN, 0}, {watchFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+        for (;;) {
+            if (::poll(listening, 3, -1) < 0) continue;
+            if (listening[2].revents) return;
+
+            if (listening[0].revents & POLLIN) {
+                int fd = accept(listenFd);
+                if (fd >= 0) {
+                    int gameId = ++gamesStarted;
+                    reactors[reactorForGame(gameId, reactors.size())]->add(
+                        fd, gameId, static_cast<uint32_t>(seeder()));
+                }
+            }
+            if (listening[1].revents & POLLIN) {
+                int fd = accept(watchFd);
+                if (fd >= 0) reactors[0]->addSpectator(fd, 0);
+            }
+        }
+    }
+
+    static int accept(int socketFd) {
+        int fd = ::accept4(socketFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        // Out of descriptors: let sessions end instead of spinning
+        if (fd < 0 && (errno == EMFILE || errno == ENFILE)) usleep(10000);
+        return fd;      // or -1: EAGAIN, EINTR, or the client already left
+    }
+
+    int sessionCount() const {
+        int total = 0;
+        for (const auto& reactor : reactors) total += reactor->sessionCount;
+        return total;
+    }
+
+    void shutdown() {
+        for (auto& reactor : reactors) reactor->stop();
+        for (auto& reactor : reactors) {
+            if (reactor->thread.joinable()) reactor->thread.join();
+        }
+        reactors.clear();
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            ::unlink(config.socketPath.c_str());
+            listenFd = -1;
+        }
+        if (watchFd >= 0) {
+            ::close(watchFd);
+            ::unlink(config.watchPath.c_str());
+            watchFd = -1;
+        }
+    }
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "broadcast.h"
+#include "compositor.h"
+#include "engine.h"
+#include "event_loop.h"
+#include "frame.h"
+#include "input.h"
+#include "renderer.h"
+
+// One game played over a socket: the client's terminal is at the other end
+// of fd, sending raw key bytes and showing the frames we send back. A
+// session never blocks; the server calls it when its socket is readable or
+// writable and on every logic tick, from whichever thread owns it.
+//
+// Output goes through the same TerminalRenderer as the local game, so only
+// the changed cells are sent. A new frame is encoded only once the last one
+// has been written completely - a slow client gets fewer, larger diffs and
+// never an unbounded backlog. Spectators get the same frames through a
+// Broadcast, which exists only while someone is watching.
+
+struct GameSession {
+    static constexpr int64_t RENDER_STEP_NS = 1000000000 / 60;
+
+    int fd{-1};
+    int id{0};                  // game number spectators ask for
+    Engine engine;
+    InputDecoder input;
+    Compositor<DEFAULT_BOARD_WIDTH, DEFAULT_BOARD_HEIGHT> compositor;
+    FrameBuilder<DEFAULT_BOARD_WIDTH, DEFAULT_BOARD_HEIGHT> frame;
+
+    // renderer.out holds the frame being sent; sent bytes of it are out
+    TerminalRenderer renderer;
+    size_t sent{0};
+    std::unique_ptr<Broadcast> broadcast;
+
+    bool paused{false};
+    bool ghostEnabled{true};
+    bool quit{false};           // the client asked to leave
+    bool dirty{true};           // state changed since the last frame
+    int64_t nextRenderNs{0};
+    uint32_t ticks{0};
+
+    void start(int socket, int gameId, uint32_t seed, Randomizer randomizer, int previewDepth) {
+        fd = socket;
+        id = gameId;
+        renderer.fd = socket;
+        engine.configure(randomizer, previewDepth);
+        engine.seed(seed);
+        restart();
+    }
+
+    void restart() {
+        engine.reset();
+        paused = false;
+        ticks = 0;
+        dirty = true;
+        renderer.invalidate();
+    }
+
+    // The client is still there and wants to play on
+    bool open() const {
+        return fd >= 0 && !quit;
+    }
+
+    bool pendingOutput() const {
+        return sent < renderer.out.size;
+    }
+
+    // ---------- events ----------
+
+    // Everything the client has sent; false once it hung up
+    bool onReadable(int64_t nowNs) {
+        if (!input.fill(fd, nowNs)) return false;
+        handleInput(nowNs);
+        return true;
+    }
+
+    void handleInput(int64_t nowNs) {
+        input.expire(nowNs);
+        KeyEvent event;
+        while (!quit && input.next(event)) {
+            if (event.action == KeyAction::Release) continue;
+            char c = commandForKey(event);
+            if (c != 0) handleKey(c);
+        }
+    }
+
+    void handleKey(char c) {
+        dirty = true;
+        if (c == 'q') {
+            quit = true;
+            return;
+        }
+        if (c == 'g') {
+            ghostEnabled = !ghostEnabled;
+            return;
+        }
+        if (!engine.state.running) {
+            if (c == 'r') restart();
+            return;
+        }
+        if (c == 'p') {
+            paused = !paused;
+            return;
+        }
+        if (paused) return;
+
+        switch (c) {
+            case 'a': engine.step(Action::MoveLeft); break;
+            case 'd': engine.step(Action::MoveRight); break;
+            case 's':
+            case 'x': engine.step(Action::Down); break;
+            case 'w': engine.step(Action::Rotate); break;
+            case ' ': engine.step(Action::HardDrop); break;
+            default: break;
+        }
+    }
+
+    // One logic step of gravity and lock delay
+    void tick() {
+        if (paused || !engine.state.running) return;
+        StepResult result = engine.tick(Action::None, false);
+        ++ticks;
+        if (result.moved || result.locked || result.gameOver) dirty = true;
+    }
+
+    // ---------- output ----------
+
+    // Sends the next frame if one is due and the last one is out. Returns
+    // false when the connection failed.
+    bool present(int64_t nowNs) {
+        if (!pendingOutput()) {
+            if (!dirty || nowNs < nextRenderNs) return true;
+            renderFrame();
+            dirty = false;
+            nextRenderNs = nowNs + RENDER_STEP_NS;
+        }
+        return writePending();
+    }
+
+    void renderFrame() {
+        compositor.lockedLayer(engine.board);
+        if (engine.state.running) {
+            Piece ghost = engine.calculateGhostPiece();
+            if (ghostEnabled && ghost.pos.y != engine.currentPiece.pos.y) {
+                compositor.ghostLayer(ghost);
+            }
+            compositor.pieceLayer(engine.currentPiece);
+        } else {
+            compositor.pieceLayer(engine.currentPiece, false);
+        }
+
+        frame.assemble(compositor.field, engine);
+        const char* status = !engine.state.running ? "  GAME OVER - R (Restart)  Q (Quit)"
+                           : paused ? "  PAUSED - P (Resume)  Q (Quit)"
+                           : "";
+        TextFrame& rows = frame.rows;
+        if (rows.count < TextFrame::MAX_LINES) {
+            TextFrame::Line& line = rows.lines[rows.count++];
+            line.clear();
+            line.append("Game ");
+            line.appendInt(id);
+            if (broadcast) {
+                line.append(" (");
+                line.appendInt(static_cast<long>(broadcast->viewers.size()));
+                line.append(" watching)");
+            }
+            line.append(status);
+        }
+
+        renderer.encode(rows);
+        sent = 0;
+        if (broadcast) broadcast->publish(rows);
+    }
+
+    // As much of the current frame as the socket takes without blocking;
+    // false on a connection error
+    bool writePending() {
+        while (pendingOutput()) {
+            ssize_t n = ::send(fd, renderer.out.data + sent, renderer.out.size - sent,
+                               MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+};
@@ -0,0 +1,339 @@
+// tetris-sim: play many independent headless games in parallel and report
+// aggregate statistics. Each game has its own seeded Engine, so results
+// only depend on --seed, never on thread count or scheduling.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "autoplay.h"
+#include "engine.h"
+
+using namespace std;
+
+struct SimConfig {
+    int games{1000};
+    int threads{0};             // 0 = one per hardware thread
+    uint32_t seed{1};
+    string policy{"greedy"};
+    int maxPieces{2000};        // stop games that a good bot would never lose
+    Randomizer randomizer{Randomizer::Bag7};
+};
+
+struct GameResult {
+    int score{0};
+    int lines{0};
+    int level{0};
+    int pieces{0};
+    long ticks{0};
+};
+
+// ---------- player bots ----------
+
+// Mixes the base seed with the game index so neighbouring games get
+// unrelated streams
+uint32_t gameSeed(uint32_t base, uint32_t index) {
+    uint64_t z = (static_cast<uint64_t>(base) << 32) + index + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<uint32_t>(z ^ (z >> 31));
+}
+
+// Mashes random keys, one per tick
+struct RandomBot {
+    mt19937 rng;
+
+    Action nextAction(const Engine&) {
+        static const Action ACTIONS[] = {
+            Action::None, Action::None, Action::MoveLeft, Action::MoveRight,
+            Action::Rotate, Action::Down, Action::HardDrop
+        };
+        uniform_int_distribution<int> dist(0, 6);
+        return ACTIONS[dist(rng)];
+    }
+
+    void onLock() {}
+};
+
+// For each new piece, tries every rotation and column with a straight drop,
+// scores the resulting board and then walks the piece there one key per tick
+struct GreedyBot {
+    mt19937 rng;
+    int plannedFor{-1};         // piece count the current plan belongs to
+    int targetRotation{0};
+    int targetX{0};
+    int pieces{0};
+
+    EvalWeights weights;        // the auto player's, so the simulator measures it
+
+    double evaluate(const Board& board, int lines) const {
+        return evaluateBoard<Board::WIDTH>(board.rows, weights) + weights.lines * lines;
+    }
+
+    void plan(const Engine& engine) {
+        const Piece& piece = engine.currentPiece;
+        double best = -1e18;
+        targetRotation = piece.rotation;
+        targetX = piece.pos.x;
+
+        for (int rot = 0; rot < 4; ++rot) {
+            const PieceMask* masks = BlockTemplate::rowMasks(piece.type, rot);
+            for (int x = -BLOCK_SIZE + 1; x < Board::WIDTH; ++x) {
+                int y = piece.pos.y;
+                if (engine.board.collides(masks, x, y)) continue;
+                while (!engine.board.collides(masks, x, y + 1)) ++y;
+
+                Piece landed = piece;
+                landed.rotation = rot;
+                landed.pos = Position(x, y);
+
+                Board trial = engine.board;
+                Engine::lockPiece(trial, landed);
+                int lines = trial.clearLines();
+
+                double value = evaluate(trial, lines);
+                if (value > best) {
+                    best = value;
+                    targetRotation = rot;
+                    targetX = x;
+                }
+            }
+        }
+    }
+
+    Action nextAction(const Engine& engine) {
+        if (plannedFor != pieces) {
+            plan(engine);
+            plannedFor = pieces;
+        }
+
+        const Piece& piece = engine.currentPiece;
+        if (piece.rotation != targetRotation) return Action::Rotate;
+        if (piece.pos.x > targetX) return Action::MoveLeft;
+        if (piece.pos.x < targetX) return Action::MoveRight;
+        return Action::HardDrop;
+    }
+
+    void onLock() {
+        ++pieces;
+    }
+};
+
+template <typename Bot>
+GameResult playGame(const SimConfig& config, uint32_t seed) {
+    Engine engine;
+    engine.configure(config.randomizer, 1);
+    engine.seed(seed);
+    engine.reset();
+
+    Bot bot;
+    bot.rng.seed(seed ^ 0xA5A5A5A5u);
+
+    GameResult result;
+    while (engine.state.running && result.pieces < config.maxPieces) {
+        StepResult step = engine.tick(bot.nextAction(engine), false);
+        ++result.ticks;
+        if (step.locked) {
+            ++result.pieces;
+            bot.onLock();
+        }
+    }
+
+    result.score = engine.state.score;
+    result.lines = engine.state.linesCleared;
+    result.level = engine.state.level;
+    return result;
+}
+
+// ---------- worker pool ----------
+
+// Each worker owns a deque of game indices. It takes work from the front
+// of its own deque and, once empty, steals from the back of the others.
+struct WorkQueue {
+    mutex lock;
+    deque<int> games;
+
+    bool popFront(int& game) {
+        lock_guard<mutex> guard(lock);
+        if (games.empty()) return false;
+        game = games.front();
+        games.pop_front();
+        return true;
+    }
+
+    bool stealBack(int& game) {
+        lock_guard<mutex> guard(lock);
+        if (games.empty()) return false;
+        game = games.back();
+        games.pop_back();
+        return true;
+    }
+};
+
+struct SimPool {
+    const SimConfig& config;
+    vector<WorkQueue> queues;
+    vector<GameResult> results;
+    atomic<long> stolen{0};
+
+    explicit SimPool(const SimConfig& cfg, int threadCount)
+        : config(cfg), queues(threadCount), results(cfg.games) {
+        // Contiguous blocks per worker; stealing evens out long games
+        for (int i = 0; i < config.games; ++i) {
+            queues[static_cast<size_t>(i) * threadCount / config.games].games.push_back(i);
+        }
+    }
+
+    GameResult play(int game) const {
+        uint32_t seed = gameSeed(config.seed, static_cast<uint32_t>(game));
+        if (config.policy == "random") {
+            return playGame<RandomBot>(config, seed);
+        }
+        return playGame<GreedyBot>(config, seed);
+    }
+
+    bool nextGame(int self, int& game) {
+        if (queues[self].popFront(game)) return true;
+
+        int n = static_cast<int>(queues.size());
+        for (int k = 1; k < n; ++k) {
+            if (queues[(self + k) % n].stealBack(game)) {
+                ++stolen;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker(int self) {
+        int game = 0;
+        while (nextGame(self, game)) {
+            results[game] = play(game);
+        }
+    }
+
+    void run() {
+        vector<thread> workers;
+        for (size_t i = 0; i < queues.size(); ++i) {
+            workers.emplace_back(&SimPool::worker, this, static_cast<int>(i));
+        }
+        for (thread& t : workers) {
+            t.join();
+        }
+    }
+};
+
+// ---------- reporting ----------
+
+template <typename T>
+T percentile(const vector<T>& sorted, double p) {
+    if (sorted.empty()) return T{};
+    size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+void report(const SimConfig& config, int threadCount, const vector<GameResult>& results,
+            double seconds, long stolen) {
+    vector<int> scores, lines;
+    long totalPieces = 0, totalTicks = 0;
+    double scoreSum = 0, linesSum = 0, levelSum = 0;
+    int maxLevel = 0;
+
+    for (const GameResult& r : results) {
+        scores.push_back(r.score);
+        lines.push_back(r.lines);
+        scoreSum += r.score;
+        linesSum += r.lines;
+        levelSum += r.level;
+        maxLevel = max(maxLevel, r.level);
+        totalPieces += r.pieces;
+        totalTicks += r.ticks;
+    }
+    sort(scores.begin(), scores.end());
+    sort(lines.begin(), lines.end());
+
+    double n = results.empty() ? 1.0 : static_cast<double>(results.size());
+
+    printf("games:       %d (policy %s, %s randomizer, seed %u, %d threads, %ld stolen)\n",
+           config.games, config.policy.c_str(),
+           RANDOMIZER_NAMES[static_cast<int>(config.randomizer)], config.seed,
+           threadCount, stolen);
+    printf("wall time:   %.3f s\n", seconds);
+    printf("games/sec:   %.1f\n", results.size() / seconds);
+    printf("pieces/sec:  %.0f\n", totalPieces / seconds);
+    printf("ticks/sec:   %.0f\n", totalTicks / seconds);
+    printf("score:       mean %.1f  p50 %d  p90 %d  p99 %d  max %d\n",
+           scoreSum / n, percentile(scores, 50), percentile(scores, 90),
+           percentile(scores, 99), scores.empty() ? 0 : scores.back());
+    printf("lines:       mean %.1f  p50 %d  p90 %d  p99 %d  max %d\n",
+           linesSum / n, percentile(lines, 50), percentile(lines, 90),
+           percentile(lines, 99), lines.empty() ? 0 : lines.back());
+    printf("level:       mean %.2f  max %d\n", levelSum / n, maxLevel);
+}
+
+void printUsage(const char* argv0) {
+    fprintf(stderr,
+            "usage: %s [--games N] [--threads N] [--seed N] [--policy greedy|random]\n"
+            "          [--max-pieces N] [--randomizer bag|history|uniform]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    SimConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue) {
+            config.games = atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            config.threads = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            config.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--policy" && hasValue) {
+            config.policy = argv[++i];
+        } else if (arg == "--max-pieces" && hasValue) {
+            config.maxPieces = atoi(argv[++i]);
+        } else if (arg == "--randomizer" && hasValue) {
+            if (!parseRandomizer(argv[++i], config.randomizer)) {
+                fprintf(stderr, "unknown randomizer: %s\n", argv[i]);
+                return 2;
+            }
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (config.policy != "greedy" && config.policy != "random") {
+        fprintf(stderr, "unknown policy: %s\n", config.policy.c_str());
+        return 2;
+    }
+    if (config.games <= 0) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    int threadCount = config.threads;
+    if (threadCount <= 0) {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    threadCount = min(threadCount, config.games);
+
+    SimPool pool(config, threadCount);
+
+    auto start = chrono::steady_clock::now();
+    pool.run();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    report(config, threadCount, pool.results, seconds, pool.stolen.load());
+    return 0;
+}
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "engine.h"
+#include "file_io.h"
+
+// Mid-game snapshots: everything needed to carry on exactly where a game
+// was - board, score, falling piece, the queue and the randomizer's
+// position in its stream, gravity and lock delay - so a lost terminal
+// does not lose the game, and benchmarks and bug reports can start from
+// an exact position. Written with replaceFile(), so a crash never leaves
+// half a snapshot.
+//
+// File layout (little endian):
+//   "TSNP" version:u8 width:u8 height:u8 randomizer:u8 depth:u8 flags:u8
+//   score:u32 lines:u32 level:u32 ticks:u32
+//   piece type:u8 rotation:u8 x:i8 y:i8
+//   gravityAccum:u32 lockTicks:u32 garbagePending:u32 garbageRng:u32
+//   rngSeed:u32 rngDraws:u32 x2 bagLeft:u8 bag:u8[7] history:u8[4]
+//   queued:u8, then that many piece types (u8)
+//   board: one occupancy bit per cell, then 3 bits per locked cell with
+//   its block type (7 = garbage), row by row from the top, LSB first
+//   crc32 of everything before it
+// flags: bit 0 = game running, bit 1 = history randomizer's first piece.
+
+struct Snapshot {
+    static constexpr char MAGIC[4] = {'T', 'S', 'N', 'P'};
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t FIXED_SIZE = 71;    // everything before the queued pieces
+    static constexpr int TYPE_BITS = 3;
+    static constexpr int GARBAGE_TYPE = 7;
+
+    int boardWidth{DEFAULT_BOARD_WIDTH};
+    int boardHeight{DEFAULT_BOARD_HEIGHT};
+    std::vector<uint8_t> bytes;     // the encoded snapshot, checksum included
+
+    template <int Width, int Height>
+    void capture(const BasicEngine<Width, Height>& engine, uint32_t ticks) {
+        const PieceQueue& queue = engine.queue;
+        const PieceGenerator& generator = queue.generator;
+        boardWidth = Width;
+        boardHeight = Height;
+
+        bytes.assign(MAGIC, MAGIC + 4);
+        bytes.push_back(VERSION);
+        bytes.push_back(static_cast<uint8_t>(Width));
+        bytes.push_back(static_cast<uint8_t>(Height));
+        bytes.push_back(static_cast<uint8_t>(generator.kind));
+        bytes.push_back(static_cast<uint8_t>(queue.depth));
+        bytes.push_back(static_cast<uint8_t>((engine.state.running ? 1 : 0) |
+                                             (generator.firstPiece ? 2 : 0)));
+
+        putU32(static_cast<uint32_t>(engine.state.score));
+        putU32(static_cast<uint32_t>(engine.state.linesCleared));
+        putU32(static_cast<uint32_t>(engine.state.level));
+        putU32(ticks);
+
+        const Piece& piece = engine.currentPiece;
+        bytes.push_back(static_cast<uint8_t>(piece.type));
+        bytes.push_back(static_cast<uint8_t>(piece.rotation));
+        bytes.push_back(static_cast<uint8_t>(static_cast<int8_t>(piece.pos.x)));
+        bytes.push_back(static_cast<uint8_t>(static_cast<int8_t>(piece.pos.y)));
+
+        putU32(static_cast<uint32_t>(engine.gravityAccum));
+        putU32(static_cast<uint32_t>(engine.lockTicks));
+        putU32(static_cast<uint32_t>(engine.garbagePending));
+        putU32(engine.garbageRng);
+
+        putU32(generator.rng.seedValue);
+        putU32(static_cast<uint32_t>(generator.rng.draws));
+        putU32(static_cast<uint32_t>(generator.rng.draws >> 32));
+        bytes.push_back(static_cast<uint8_t>(generator.bagLeft));
+        bytes.insert(bytes.end(), generator.bag, generator.bag + NUM_BLOCK_TYPES);
+        bytes.insert(bytes.end(), generator.history, generator.history + PieceGenerator::HISTORY_SIZE);
+
+        bytes.push_back(static_cast<uint8_t>(queue.count));
+        for (uint32_t i = 0; i < queue.count; ++i) {
+            bytes.push_back(static_cast<uint8_t>(queue.peek(static_cast<int>(i))));
+        }
+
+        // Occupancy first, then the block types of the locked cells only
+        BitWriter bits{bytes};
+        for (int y = 0; y < Height; ++y) {
+            for (int x = 0; x < Width; ++x) bits.put(engine.board.isOccupied(y, x), 1);
+        }
+        for (int y = 0; y < Height; ++y) {
+            for (int x = 0; x < Width; ++x) {
+                if (engine.board.isOccupied(y, x)) bits.put(typeOfCell(engine.board.grid[y][x]), TYPE_BITS);
+            }
+        }
+        bits.flush();
+
+        putU32(crc32(bytes.data(), bytes.size()));
+    }
+
+    // Puts the engine back where capture() was called; ticks is the game
+    // time. The engine must have the snapshot's board size. Returns false
+    // for a snapshot that does not decode or describes an impossible game
+    // (a piece outside the board or in locked cells, a piece type out of
+    // range), leaving the engine as it was.
+    template <int Width, int Height>
+    bool restore(BasicEngine<Width, Height>& engine, uint32_t& ticks) const {
+        using RowMask = typename BasicBoard<Width, Height>::RowMask;
+        if (boardWidth != Width || boardHeight != Height || !valid()) return false;
+
+        BasicEngine<Width, Height> restored = engine;
+        PieceQueue& queue = restored.queue;
+        PieceGenerator& generator = queue.generator;
+        size_t pos = 7;
+
+        generator.kind = static_cast<Randomizer>(bytes[pos++]);
+        queue.depth = bytes[pos++];
+        uint8_t flags = bytes[pos++];
+        restored.state.running = (flags & 1) != 0;
+        generator.firstPiece = (flags & 2) != 0;
+        if (queue.depth < 1 || queue.depth > PieceQueue::MAX_DEPTH) return false;
+
+        restored.state.score = static_cast<int>(getU32(pos));
+        restored.state.linesCleared = static_cast<int>(getU32(pos));
+        restored.state.level = static_cast<int>(getU32(pos));
+        uint32_t gameTicks = getU32(pos);
+
+        Piece& piece = restored.currentPiece;
+        piece.type = bytes[pos++];
+        piece.rotation = bytes[pos++];
+        piece.pos.x = static_cast<int8_t>(bytes[pos++]);
+        piece.pos.y = static_cast<int8_t>(bytes[pos++]);
+        if (piece.type >= NUM_BLOCK_TYPES || piece.rotation >= 4 ||
+            piece.pos.x < 1 - BLOCK_SIZE || piece.pos.x >= Width ||
+            piece.pos.y < -BLOCK_SIZE || piece.pos.y >= Height) {
+            return false;
+        }
+
+        restored.gravityAccum = static_cast<int32_t>(getU32(pos));
+        restored.lockTicks = static_cast<int>(getU32(pos));
+        restored.garbagePending = static_cast<int>(getU32(pos));
+        restored.garbageRng = getU32(pos);
+
+        uint32_t seed = getU32(pos);
+        uint64_t draws = getU32(pos);
+        draws |= static_cast<uint64_t>(getU32(pos)) << 32;
+        generator.bagLeft = bytes[pos++];
+        std::copy(&bytes[pos], &bytes[pos] + NUM_BLOCK_TYPES, generator.bag);
+        pos += NUM_BLOCK_TYPES;
+        std::copy(&bytes[pos], &bytes[pos] + PieceGenerator::HISTORY_SIZE, generator.history);
+        pos += PieceGenerator::HISTORY_SIZE;
+        if (generator.bagLeft > NUM_BLOCK_TYPES || !validTypes(generator.bag, NUM_BLOCK_TYPES) ||
+            !validTypes(generator.history, PieceGenerator::HISTORY_SIZE)) {
+            return false;
+        }
+
+        queue.head = 0;
+        queue.count = bytes[pos++];
+        if (queue.count > static_cast<uint32_t>(queue.depth) ||
+            bytes.size() < pos + queue.count + (Width * Height + 7) / 8 + 4) {
+            return false;
+        }
+        for (uint32_t i = 0; i < queue.count; ++i) {
+            queue.ring[i] = bytes[pos++];
+            if (queue.ring[i] >= NUM_BLOCK_TYPES) return false;
+        }
+
+        // Occupancy, then a type per locked cell; lockCell() keeps the
+        // hash and skyline up to date
+        BitReader bits{bytes, pos, bytes.size() - 4};
+        RowMask rows[Height];
+        for (int y = 0; y < Height; ++y) {
+            rows[y] = 0;
+            for (int x = 0; x < Width; ++x) {
+                if (bits.get(1)) rows[y] |= static_cast<RowMask>(RowMask{1} << x);
+            }
+        }
+        restored.board.init();
+        for (int y = 0; y < Height; ++y) {
+            for (int x = 0; x < Width; ++x) {
+                if (!((rows[y] >> x) & 1u)) continue;
+                int type = static_cast<int>(bits.get(TYPE_BITS));
+                restored.board.lockCell(y, x, type == GARBAGE_TYPE ? '#' : BLOCK_NAMES[type]);
+            }
+        }
+        if (bits.overrun || bits.end() != bytes.size() - 4) return false;
+        // The piece is inside the walls; in a running game it sits in free
+        // cells too, after a top out it may overlap the stack
+        BasicBoard<Width, Height> walls;
+        walls.init();
+        const PieceMask* masks = BlockTemplate::rowMasks(piece.type, piece.rotation);
+        if (walls.collides(masks, piece.pos.x, piece.pos.y) ||
+            (restored.state.running && !restored.canSpawn(piece))) {
+            return false;
+        }
+
+        // Last, so a failed restore leaves the engine's stream alone
+        generator.rng.restore(seed, draws);
+        engine = restored;
+        ticks = gameTicks;
+        return true;
+    }
+
+    // Magic, version, board size and checksum; restore() checks the rest
+    bool valid() const {
+        return bytes.size() >= FIXED_SIZE + 4 &&
+               std::equal(MAGIC, MAGIC + 4, bytes.begin()) && bytes[4] == VERSION &&
+               bytes[7] <= static_cast<uint8_t>(Randomizer::History) &&
+               crc32(bytes.data(), bytes.size() - 4) == readU32(bytes.data() + bytes.size() - 4);
+    }
+
+    // ---------- files ----------
+
+    bool save(const char* path) const {
+        return replaceFile(path, bytes);
+    }
+
+    // Returns false for a missing, truncated, corrupt or foreign file
+    bool load(const char* path) {
+        bytes.clear();
+        if (!readFile(path, bytes) || !valid()) return false;
+        boardWidth = bytes[5];
+        boardHeight = bytes[6];
+        return true;
+    }
+
+    // ---------- encoding ----------
+
+    static bool validTypes(const uint8_t* types, int count) {
+        for (int i = 0; i < count; ++i) {
+            if (types[i] >= NUM_BLOCK_TYPES) return false;
+        }
+        return true;
+    }
+
+    static int typeOfCell(char symbol) {
+        for (int type = 0; type < NUM_BLOCK_TYPES; ++type) {
+            if (BLOCK_NAMES[type] == symbol) return type;
+        }
+        return GARBAGE_TYPE;
+    }
+
+    void putU32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    uint32_t getU32(size_t& pos) const {
+        uint32_t value = readU32(&bytes[pos]);
+        pos += 4;
+        return value;
+    }
+
+    static uint32_t readU32(const uint8_t* in) {
+        return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+               static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+    }
+
+    // CRC-32 (IEEE), bit by bit: snapshots are a few hundred bytes
+    static uint32_t crc32(const uint8_t* data, size_t size) {
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+            }
+        }
+        return ~crc;
+    }
+
+    // Appends bits LSB first
+    struct BitWriter {
+        std::vector<uint8_t>& out;
+        uint32_t pending{0};
+        int pendingBits{0};
+
+        void put(uint32_t value, int count) {
+            pending |= value << pendingBits;
+            pendingBits += count;
+            while (pendingBits >= 8) {
+                out.push_back(static_cast<uint8_t>(pending));
+                pending >>= 8;
+                pendingBits -= 8;
+            }
+        }
+
+        void flush() {
+            if (pendingBits > 0) out.push_back(static_cast<uint8_t>(pending));
+            pending = 0;
+            pendingBits = 0;
+        }
+    };
+
+    // Reads bits LSB first from [pos, limit); past the limit it reads
+    // zeros and sets overrun
+    struct BitReader {
+        const std::vector<uint8_t>& in;
+        size_t pos;
+        size_t limit;
+        int bit{0};
+        bool overrun{false};
+
+        uint32_t get(int count) {
+            uint32_t value = 0;
+            for (int i = 0; i < count; ++i) {
+                if (pos >= limit) {
+                    overrun = true;
+                    return value;
+                }
+                value |= static_cast<uint32_t>((in[pos] >> bit) & 1u) << i;
+                if (++bit == 8) {
+                    bit = 0;
+                    ++pos;
+                }
+            }
+            return value;
+        }
+
+        // Bytes consumed, counting a partly read one
+        size_t end() const {
+            return pos + (bit > 0 ? 1 : 0);
+        }
+    };
+};
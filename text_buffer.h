@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <unistd.h>
+
+// Fixed-capacity text buffers for the per-frame rendering path: frame rows
+// and terminal output are built in place, without heap allocations or
+// iostreams. Text past the capacity is dropped and marks the buffer as
+// truncated.
+
+template <size_t Capacity>
+struct TextBuffer {
+    char data[Capacity];
+    size_t size{0};
+    bool truncated{false};
+
+    void clear() {
+        size = 0;
+        truncated = false;
+    }
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    char operator[](size_t i) const {
+        return data[i];
+    }
+
+    void append(char c) {
+        if (size < Capacity) {
+            data[size++] = c;
+        } else {
+            truncated = true;
+        }
+    }
+
+    void append(const char* text, size_t length) {
+        if (length > Capacity - size) {
+            length = Capacity - size;
+            truncated = true;
+        }
+        std::memcpy(data + size, text, length);
+        size += length;
+    }
+
+    // String literals and other NUL-terminated text
+    void append(const char* text) {
+        append(text, std::strlen(text));
+    }
+
+    void append(size_t count, char c) {
+        if (count > Capacity - size) {
+            count = Capacity - size;
+            truncated = true;
+        }
+        std::memset(data + size, c, count);
+        size += count;
+    }
+
+    template <size_t N>
+    void append(const TextBuffer<N>& other, size_t from, size_t length) {
+        append(other.data + from, length);
+    }
+
+    // Decimal integer, padded with spaces on the right to at least width
+    // characters (printf's %-<width>d)
+    void appendInt(long value, int width = 0) {
+        char digits[24];
+        int count = 0;
+        unsigned long magnitude = value < 0 ? 0ul - static_cast<unsigned long>(value)
+                                            : static_cast<unsigned long>(value);
+        do {
+            digits[count++] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+
+        int length = count + (value < 0 ? 1 : 0);
+        if (value < 0) append('-');
+        while (count > 0) append(digits[--count]);
+        if (width > length) append(static_cast<size_t>(width - length), ' ');
+    }
+
+    template <size_t N>
+    bool operator==(const TextBuffer<N>& other) const {
+        return size == other.size && std::memcmp(data, other.data, size) == 0;
+    }
+
+    template <size_t N>
+    bool operator!=(const TextBuffer<N>& other) const {
+        return !(*this == other);
+    }
+
+    // Copies only the used part
+    template <size_t N>
+    void assign(const TextBuffer<N>& other) {
+        clear();
+        append(other.data, other.size);
+        truncated = other.truncated;
+    }
+
+    // Writes everything to fd with as few write() calls as the kernel
+    // allows; false on an error other than EINTR
+    bool writeTo(int fd) const {
+        size_t written = 0;
+        while (written < size) {
+            ssize_t n = ::write(fd, data + written, size - written);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Fixed-size cache of evaluated search nodes, keyed by the Zobrist hash of
+// the board plus the piece to place and the one after (Zobrist::key). An
+// entry holds every placement of that piece with the heuristic score of
+// the board it leaves, so a search that meets the same state again - via
+// another move order, or in the next move's search - skips both move
+// generation and evaluation.
+//
+// Shared by all search threads without locks. Each slot is a sequence
+// lock: writers claim it by making the version odd and give up if another
+// writer holds it; readers never wait, they copy the entry and treat it as
+// a miss if the version moved meanwhile. Every field is a relaxed atomic,
+// ordered by the fences around the version. New entries replace old ones.
+//
+// Sized by the most placements a node may have; the auto player picks it
+// from the board width, since an empty board has about 4 per column.
+
+struct CachedChild {
+    int8_t x{0};
+    int8_t y{0};
+    uint8_t rotation{0};
+    float score{0};
+};
+
+template <int MaxChildren>
+struct BasicTranspositionTable {
+    static constexpr int MAX_CHILDREN = MaxChildren;    // nodes with more are not cached
+
+    struct Slot {
+        std::atomic<uint32_t> version{0};       // odd while being written
+        std::atomic<uint32_t> count{0};
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> children[MAX_CHILDREN];
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask{0};
+
+    // 2^bits slots of 16 + 8 * MAX_CHILDREN bytes
+    explicit BasicTranspositionTable(int bits)
+        : slots(new Slot[size_t{1} << bits]), mask((uint64_t{1} << bits) - 1) {}
+
+    // Copies the entry for key into out; returns its child count, or -1
+    int probe(uint64_t key, CachedChild* out) const {
+        const Slot& slot = slots[key & mask];
+        uint32_t before = slot.version.load(std::memory_order_acquire);
+        if (before & 1) return -1;
+
+        uint64_t stored = slot.key.load(std::memory_order_relaxed);
+        uint32_t count = slot.count.load(std::memory_order_relaxed);
+        if (stored != key || count > MAX_CHILDREN) return -1;
+        for (uint32_t i = 0; i < count; ++i) {
+            out[i] = unpack(slot.children[i].load(std::memory_order_relaxed));
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) != before) return -1;
+        return static_cast<int>(count);
+    }
+
+    void store(uint64_t key, const CachedChild* children, int count) {
+        if (count > MAX_CHILDREN) return;
+        Slot& slot = slots[key & mask];
+        uint32_t version = slot.version.load(std::memory_order_relaxed);
+        if ((version & 1) ||
+            !slot.version.compare_exchange_strong(version, version + 1,
+                                                  std::memory_order_acquire)) {
+            return;     // another thread is writing this slot
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.key.store(key, std::memory_order_relaxed);
+        slot.count.store(static_cast<uint32_t>(count), std::memory_order_relaxed);
+        for (int i = 0; i < count; ++i) {
+            slot.children[i].store(pack(children[i]), std::memory_order_relaxed);
+        }
+        slot.version.store(version + 2, std::memory_order_release);
+    }
+
+    void clear() {
+        for (uint64_t i = 0; i <= mask; ++i) {
+            slots[i].count.store(0, std::memory_order_relaxed);
+            slots[i].key.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static uint64_t pack(const CachedChild& child) {
+        uint32_t bits;
+        std::memcpy(&bits, &child.score, sizeof(bits));
+        return (static_cast<uint64_t>(bits) << 32) |
+               (static_cast<uint64_t>(static_cast<uint8_t>(child.x)) << 16) |
+               (static_cast<uint64_t>(static_cast<uint8_t>(child.y)) << 8) |
+               child.rotation;
+    }
+
+    static CachedChild unpack(uint64_t packed) {
+        CachedChild child;
+        uint32_t bits = static_cast<uint32_t>(packed >> 32);
+        std::memcpy(&child.score, &bits, sizeof(bits));
+        child.x = static_cast<int8_t>(packed >> 16);
+        child.y = static_cast<int8_t>(packed >> 8);
+        child.rotation = static_cast<uint8_t>(packed & 3);
+        return child;
+    }
+};